@@ -0,0 +1,66 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/// @brief Blocco di memoria dell'arena (lista concatenata)
+typedef struct arena_block {
+    struct arena_block *next;
+    size_t size;
+    size_t used;
+    unsigned char data[];
+} arena_block;
+
+/// @brief Arena: allocazioni che vengono liberate tutte insieme con arena_free()
+typedef struct {
+    arena_block *head;
+} arena;
+
+/// @brief Statistiche globali delle arene (dall'avvio del programma)
+typedef struct {
+    size_t n_allocs;    // Allocazioni richieste alle arene
+    size_t n_blocks;    // Blocchi allocati con malloc
+    size_t bytes;       // Byte allocati con malloc
+} arena_stats;
+
+/// @brief Inizializza un'arena vuota
+/// @param a Arena da inizializzare
+void arena_init(arena *a);
+
+/// @brief Alloca memoria dall'arena (allineata a 16 byte)
+/// @param a Arena
+/// @param size Numero di byte
+/// @return Puntatore alla memoria (NULL in caso di errore)
+void *arena_alloc(arena *a, size_t size);
+
+/// @brief Ingrandisce un'allocazione dell'arena (estesa sul posto se e' l'ultima del blocco, altrimenti copiata)
+/// @param a Arena
+/// @param ptr Allocazione da ingrandire (NULL ammesso)
+/// @param old_size Dimensione attuale
+/// @param new_size Nuova dimensione
+/// @return Puntatore alla memoria (NULL in caso di errore, la vecchia allocazione resta valida)
+void *arena_grow(arena *a, void *ptr, size_t old_size, size_t new_size);
+
+/// @brief Copia i primi n caratteri di una stringa nell'arena
+/// @param a Arena
+/// @param str Stringa da copiare
+/// @param n Numero di caratteri
+/// @return Nuova stringa terminata da '\0' (NULL in caso di errore)
+char *arena_strndup(arena *a, const char *str, size_t n);
+
+/// @brief Legge l'intero contenuto di un file nell'arena
+/// @param a Arena
+/// @param filename Nome del file
+/// @param len_out Puntatore in cui salvare il numero di byte letti (NULL se non serve)
+/// @return Buffer terminato da '\0' (NULL in caso di errore, errno impostato)
+char *arena_read_file(arena *a, const char *filename, size_t *len_out);
+
+/// @brief Libera in una sola volta tutta la memoria dell'arena
+/// @param a Arena da liberare (resta utilizzabile, vuota)
+void arena_free(arena *a);
+
+/// @brief Restituisce le statistiche globali delle arene
+/// @param out Puntatore in cui salvare le statistiche
+void arena_get_stats(arena_stats *out);
+
+#endif
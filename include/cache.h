@@ -0,0 +1,28 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "gate.h"
+#include "param.h"
+
+/// @brief Cerca il circuito compilato nella cache associata al file circuito (<circuit_file>.qcache)
+/// @param filename Nome del file circuito
+/// @param n_qubits Numero di qubits
+/// @param n_gates_out Puntatore all'int in cui salvare il numero di gate
+/// @param circuit_out Puntatore al circuito (gate*)
+/// @param params_out Puntatore alla tabella dei parametri
+/// @return EXIT_SUCCESS se la cache e' valida (stesso contenuto del file e stesso numero di qubits), altrimenti EXIT_FAILURE
+/// La cache viene letta tramite mmap: le matrici dei gate puntano nella mappatura (una per ogni #define), che resta
+/// attiva finche' l'ultimo gate non viene liberato. malloc utilizzato per "circuit_out" e "params_out", "Caller must free"
+/// @see free_circuit(), free_params()
+int cache_load(const char *filename, int n_qubits, int *n_gates_out, gate **circuit_out, param_table *params_out);
+
+/// @brief Salva il circuito compilato nella cache associata al file circuito (<circuit_file>.qcache)
+/// @param filename Nome del file circuito (il suo contenuto viene usato come chiave)
+/// @param n_qubits Numero di qubits
+/// @param circuit Circuito da salvare
+/// @param n_gates Numero di gate
+/// @param params Tabella dei parametri
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+int cache_store(const char *filename, int n_qubits, const gate *circuit, int n_gates, const param_table *params);
+
+#endif
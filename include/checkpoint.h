@@ -0,0 +1,49 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <stdint.h>
+#include "complex.h"
+#include "gate.h"
+#include "sha256.h"
+
+/// @brief Chiave di un prefisso del circuito: digest SHA-256 dello stato iniziale e dei primi gate
+typedef struct {
+    unsigned char digest[SHA256_SIZE];
+} checkpoint_key;
+
+/// @brief Indica se esistono checkpoint per il file circuito (cartella <circuit_file>.ckpt)
+/// @param filename Nome del file circuito
+/// @return 1 se la cartella esiste, altrimenti 0
+int checkpoint_exists(const char *filename);
+
+/// @brief Calcola le chiavi dei prefissi del circuito (catena di hash sullo stato iniziale e sul contenuto dei gate)
+/// Ogni matrice distinta (un #define, condiviso da tutti i suoi usi) viene hashata una sola volta
+/// @param init_vec Stato iniziale
+/// @param n_qubits Numero di qubits
+/// @param circuit Circuito
+/// @param n_gates Numero di gate
+/// @param keys Array di n_gates + 1 elementi: keys[k] identifica lo stato dopo i primi k gate
+/// @return EXIT_FAILURE (allocazione fallita) o EXIT_SUCCESS
+int checkpoint_keys(const complex *init_vec, int n_qubits, const gate *circuit, int n_gates, checkpoint_key *keys);
+
+/// @brief Cerca il prefisso piu' lungo del circuito con uno stato salvato e lo legge
+/// (solo se la chiave nell'header del checkpoint coincide con quella del prefisso)
+/// @param filename Nome del file circuito
+/// @param keys Chiavi calcolate da checkpoint_keys()
+/// @param n_gates Numero di gate
+/// @param n_qubits Numero di qubits
+/// @param out Vettore (dim elementi) in cui leggere lo stato (modificato anche se la lettura fallisce)
+/// @return Numero di gate del prefisso ripristinato (0 se non ci sono checkpoint validi)
+int checkpoint_restore(const char *filename, const checkpoint_key *keys, int n_gates, int n_qubits, complex *out);
+
+/// @brief Salva lo stato dopo i primi prefix_len gate in <circuit_file>.ckpt/<chiave>.state
+/// (un checkpoint gia' presente viene riscritto se la chiave nell'header non corrisponde)
+/// @param filename Nome del file circuito
+/// @param key Chiave del prefisso (&keys[prefix_len])
+/// @param prefix_len Numero di gate applicati
+/// @param n_qubits Numero di qubits
+/// @param vec Stato da salvare
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+int checkpoint_save(const char *filename, const checkpoint_key *key, int prefix_len, int n_qubits, const complex *vec);
+
+#endif
@@ -0,0 +1,40 @@
+#ifndef FUSE_H
+#define FUSE_H
+
+#include <stddef.h>
+#include "complex.h"
+#include "gate.h"
+
+/// @brief Massimo numero di qubits per cui un blocco ripetuto puo' essere fuso in una matrice
+/// (2^11 * 2^11 complessi = 64 MB per matrice)
+#define FUSE_MAX_QUBITS 11
+
+/// @brief Calcola la matrice dim*dim (per righe) equivalente a un gate di qualsiasi tipo
+/// @param g Gate (anche un GATE_BLOCK)
+/// @param out Array di dim*dim complessi in cui salvare la matrice
+/// @param dim Dimensione del vettore di stato
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+/// Ogni colonna e' l'immagine di un vettore della base: le colonne vengono calcolate in parallelo dal pool.
+int gate_to_matrix(const gate *g, complex *out, size_t dim);
+
+/// @brief Stima il costo (operazioni sui complessi) di una applicazione del gate
+/// @param g Gate
+/// @param dim Dimensione del vettore di stato
+/// @return Costo stimato
+double gate_cost(const gate *g, size_t dim);
+
+/// @brief Decide se conviene sostituire un blocco ripetuto con la potenza della sua matrice
+/// @param g Gate di tipo GATE_BLOCK
+/// @param dim Dimensione del vettore di stato
+/// @return 1 se conviene fondere il blocco, altrimenti 0
+/// Un blocco con parametri (#param) non viene mai fuso, perche' uno sweep deve poterlo ricalcolare.
+int block_should_fuse(const gate *g, size_t dim);
+
+/// @brief Sostituisce un blocco ripetuto con un GATE_MATRIX uguale alla matrice del blocco elevata a reps
+/// @param g Gate di tipo GATE_BLOCK (viene modificato, i suoi gate vengono liberati)
+/// @param dim Dimensione del vettore di stato
+/// @return EXIT_FAILURE (il gate resta invariato) o EXIT_SUCCESS
+/// La potenza e' calcolata per quadrati successivi: O(log2(reps)) prodotti di matrici.
+int block_fuse(gate *g, size_t dim);
+
+#endif
@@ -1,17 +1,120 @@
 #ifndef GATE_H
 #define GATE_H
 
+#include <stddef.h>
 #include "complex.h"
 
-/// @brief Struttura dati per contenere i gate
+/// @brief Tipo di gate: matrice definita con #define, gate parametrico su un singolo qubit oppure gate della libreria
+typedef enum {
+    GATE_MATRIX = 0,
+    GATE_RX,
+    GATE_RY,
+    GATE_RZ,
+    GATE_U3,
+    GATE_X,
+    GATE_Y,
+    GATE_Z,
+    GATE_HADAMARD,
+    GATE_S,
+    GATE_T,
+    GATE_CNOT,
+    GATE_SWAP,
+    GATE_CZ,
+    GATE_BLOCK
+} gate_kind;
+
+/// @brief Ultimo tipo di gate valido
+#define GATE_KIND_LAST GATE_BLOCK
+
+/// @brief Argomento di un gate parametrico: costante numerica oppure riferimento a un #param
+typedef struct {
+    int param;    // Indice nella tabella dei parametri, -1 se costante
+    double value; // Valore della costante (usato solo se param == -1)
+} gate_arg;
+
+/// @brief Memoria condivisa dalle matrici di piu' gate (un #define usato piu' volte, il file di cache mappato)
+/// Viene liberata quando viene rilasciato l'ultimo riferimento
 typedef struct {
+    int refs;
+    void *mem;          // Memoria da liberare: allocata con malloc, oppure mappata con mmap se map_size > 0
+    size_t map_size;
+} gate_storage;
+
+/// @brief Struttura dati per contenere i gate
+typedef struct gate {
     char *name;
-    complex *matrix; 
+    complex *matrix;    // Matrice dim*dim, solo per GATE_MATRIX (NULL per gli altri tipi)
+    gate_storage *storage; // Se non NULL la matrice e' condivisa e appartiene a storage, non al gate
+    gate_kind kind;
+    int target;         // Qubit su cui agisce il gate (qubit 0 = bit meno significativo)
+    int control;        // Qubit di controllo per CNOT/CZ, primo qubit per SWAP
+    gate_arg args[3];   // Argomenti di un gate parametrico (RX/RY/RZ ne usano 1, U3 ne usa 3)
+    complex u[4];       // Matrice 2x2 di un gate parametrico, per righe (calcolata da gate_bind())
+    struct gate *sub;   // Gate di un GATE_BLOCK (sotto-circuito ripetuto), di proprieta' del blocco
+    int n_sub;          // Numero di gate in sub
+    int reps;           // Ripetizioni del blocco
 } gate;
 
-/// @brief Funzione per liberare i gate di un circuito e il circuito stesso
+/// @brief Crea una memoria condivisa, con un riferimento per il chiamante
+/// @param mem Memoria di cui prendere la proprieta' (malloc, oppure mmap se map_size > 0)
+/// @param map_size Dimensione della mappatura, 0 se mem e' stata allocata con malloc
+/// @return Memoria condivisa (NULL in caso di errore, mem resta del chiamante)
+/// @see gate_storage_release()
+gate_storage *gate_storage_new(void *mem, size_t map_size);
+
+/// @brief Rilascia un riferimento a una memoria condivisa, liberandola con l'ultimo
+/// @param s Memoria condivisa (NULL ammesso)
+void gate_storage_release(gate_storage *s);
+
+/// @brief Fa usare a un gate una matrice contenuta in una memoria condivisa (aggiunge un riferimento)
+/// @param g Gate di tipo GATE_MATRIX, senza matrice propria
+/// @param s Memoria condivisa che contiene la matrice
+/// @param matrix Matrice dim*dim dentro s
+void gate_share_matrix(gate *g, gate_storage *s, complex *matrix);
+
+/// @brief Libera le risorse di un gate (nome, matrice o riferimento alla matrice condivisa, gate del blocco) ma non il gate stesso
+/// @param g Gate da liberare
+void gate_release(gate *g);
+
+/// @brief Funzione per liberare i gate di un circuito e il circuito stesso (compresi i gate dei blocchi)
 /// @param circuit Puntatore al circuito (Array di gate) 
 /// @param n_gates Numero di gate da liberare
 void free_circuit(gate *circuit, int n_gates);
 
-#endif
\ No newline at end of file
+/// @brief Numero di argomenti reali (esclusi i qubit) richiesti da un tipo di gate
+/// @param kind Tipo di gate
+/// @return Numero di argomenti (0 per i gate non parametrici)
+int gate_n_args(gate_kind kind);
+
+/// @brief Numero di qubit su cui agisce un gate della libreria o parametrico
+/// @param kind Tipo di gate
+/// @return Numero di qubit (0 per GATE_MATRIX)
+int gate_n_qubits(gate_kind kind);
+
+/// @brief Ricalcola la matrice 2x2 di un gate parametrico usando i valori dei parametri dati
+/// @param g Gate da aggiornare (per un GATE_BLOCK vengono aggiornati tutti i suoi gate)
+/// @param values Valori dei parametri (indicizzati come la tabella dei parametri)
+/// Non fa nulla per i gate non parametrici
+void gate_bind(gate *g, const double *values);
+
+/// @brief Indica se un gate dipende da qualche #param
+/// @param g Gate da controllare (per un GATE_BLOCK vengono controllati tutti i suoi gate)
+/// @return 1 se il gate usa almeno un parametro, altrimenti 0
+int gate_uses_params(const gate *g);
+
+/// @brief Applica un singolo gate al vettore, usando il kernel specializzato per il suo tipo
+/// @param g Gate da applicare
+/// @param vec Vettore di stato (viene sovrascritto con il risultato)
+/// @param t_vec Array temp di supporto (dim elementi, usato solo da GATE_MATRIX)
+/// @param dim Dimensione del vettore
+void apply_gate(const gate *g, complex *vec, complex *t_vec, size_t dim);
+
+/// @brief Applica in ordine tutti i gate del circuito al vettore
+/// @param circuit Circuito da applicare
+/// @param n_gates Numero di gate
+/// @param vec Vettore di stato (viene sovrascritto con il risultato)
+/// @param t_vec Array temp di supporto (dim elementi)
+/// @param dim Dimensione del vettore
+void apply_circuit(const gate *circuit, int n_gates, complex *vec, complex *t_vec, size_t dim);
+
+#endif
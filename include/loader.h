@@ -3,23 +3,48 @@
 
 #include "complex.h"
 #include "gate.h"
+#include "param.h"
 
 /// @brief Carica i dati dei qubit e del vettore da file
 /// @param filename Nome del file da cui leggere
 /// @param n_qubits Puntatore all'int in cui salvare il numero di qubits
 /// @param out_vec  Puntatore all'array di complessi in cui salvare il vettore letto da file
 /// @return EXIT_FAILURE o EXIT_SUCCESS
-/// malloc utilizzato internamente per "out", "Caller must free"
+/// statevec_alloc utilizzato internamente per "out_vec", "Caller must free" con statevec_free()
 int load_qubits_init(const char *filename, int *n_qubits, complex **out_vec);
 
 /// @brief Carica i dati del circuito e dei gate da file
 /// @param filename Nome del file da cui leggere
 /// @param n_gates_out Puntatore all'int in cui salvare il numero di gate caricati
 /// @param circuit_out Puntatore al circuito (gate*)
+/// @param params_out Puntatore alla tabella in cui salvare i parametri dichiarati con #param (NULL se non servono)
 /// @param n_qubits Numero di qubits (Serve per la dimensione delle matrici)
 /// @return EXIT_FAILURE o EXIT_SUCCESS
 /// malloc utilizzato internamente per "circuit_out", "Caller must free"
-/// @see free_circuit()
-int load_gates_circ(const char *filename, int *n_gates_out, gate **circuit_out, const int n_qubits);
+/// @see free_circuit(), free_params()
+int load_gates_circ(const char *filename, int *n_gates_out, gate **circuit_out, param_table *params_out, const int n_qubits);
+
+/// @brief Funzione che riceve i gate del circuito man mano che vengono risolti
+/// @param g Gate (la funzione ne prende la proprieta' anche in caso di errore, vedi gate_release())
+/// @param ctx Contesto passato a load_gates_stream()
+/// @return EXIT_FAILURE (il caricamento si interrompe) o EXIT_SUCCESS
+typedef int (*gate_sink)(gate *g, void *ctx);
+
+/// @brief Come load_gates_circ() ma passa ogni gate a "sink" appena risolto, senza tenere il circuito in memoria
+/// @param filename Nome del file da cui leggere
+/// @param n_qubits Numero di qubits (Serve per la dimensione delle matrici)
+/// @param sink Funzione chiamata per ogni gate, nell'ordine di #circ
+/// @param ctx Contesto passato a sink
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+int load_gates_stream(const char *filename, const int n_qubits, gate_sink sink, void *ctx);
+
+/// @brief Carica i punti di uno sweep dei parametri da file
+/// @param filename Nome del file da cui leggere
+/// @param params Tabella dei parametri del circuito (i parametri non elencati in #sweep mantengono il default)
+/// @param n_points_out Puntatore all'int in cui salvare il numero di punti
+/// @param points_out Puntatore all'array (n_points * params->n_params) in cui salvare i valori dei parametri
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+/// malloc utilizzato internamente per "points_out", "Caller must free"
+int load_sweep(const char *filename, const param_table *params, int *n_points_out, double **points_out);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,28 @@
+#ifndef PARAM_H
+#define PARAM_H
+
+/// @brief Tabella dei parametri dichiarati con #param
+typedef struct {
+    int n_params;
+    char **names;
+    double *values; // Valori di default (binding presente nel file circuito)
+} param_table;
+
+/// @brief Cerca un parametro per nome
+/// @param params Tabella dei parametri
+/// @param name Nome del parametro
+/// @return Indice del parametro, -1 se non trovato
+int param_find(const param_table *params, const char *name);
+
+/// @brief Aggiunge un parametro alla tabella
+/// @param params Tabella dei parametri
+/// @param name Nome del parametro (viene copiato)
+/// @param value Valore di default
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+int param_add(param_table *params, const char *name, double value);
+
+/// @brief Libera la memoria della tabella (non la struttura stessa)
+/// @param params Tabella da liberare
+void free_params(param_table *params);
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <stddef.h>
+#include "complex.h"
+
+/// @brief Funzione eseguita dai worker per ogni indice
+/// @param idx Indice del task da eseguire
+/// @param worker Indice del worker che esegue il task (0 <= worker < pool_size())
+/// @param ctx Contesto condiviso passato a pool_for()
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+typedef int (*pool_task)(size_t idx, int worker, void *ctx);
+
+/// @brief Numero di worker del pool (core online, oppure variabile d'ambiente QCS_THREADS)
+/// @return Numero di worker (>= 1)
+int pool_size(void);
+
+/// @brief Esegue task(idx) per ogni idx in [0, n) distribuendo gli indici sui worker
+/// @param n Numero di task
+/// @param task Funzione da eseguire
+/// @param ctx Contesto condiviso
+/// @return EXIT_FAILURE se almeno un task e' fallito (i task rimanenti non vengono eseguiti), altrimenti EXIT_SUCCESS
+/// Se chiamata da dentro un task, o mentre un altro thread usa il pool, i task vengono eseguiti in modo seriale dal thread chiamante
+int pool_for(size_t n, pool_task task, void *ctx);
+
+/// @brief Esegue task(w, w) una volta per ogni worker w in [0, pool_size()), ogni worker sempre sullo stesso thread
+/// (e sulla stessa CPU se la variabile d'ambiente QCS_PIN vale 1)
+/// @param task Funzione da eseguire (di solito lavora sulla porzione restituita da pool_range())
+/// @param ctx Contesto condiviso
+/// @return EXIT_FAILURE se almeno un task e' fallito, altrimenti EXIT_SUCCESS
+/// Da usare per il lavoro che deve toccare sempre la stessa memoria dallo stesso worker (first touch NUMA)
+int pool_static(pool_task task, void *ctx);
+
+/// @brief Permette al thread chiamante di girare su tutte le CPU del pool
+/// Da chiamare nei thread che non fanno parte del pool: altrimenti ereditano la CPU del worker 0 dal thread che li crea
+void pool_unpin(void);
+
+/// @brief Granularita' minima della ripartizione statica del vettore di stato, in elementi (una pagina da 4 KB)
+/// Con le huge pages la ripartizione usa pagine intere, vedi statevec_align()
+#define PARTITION_ALIGN (4096 / sizeof(complex))
+
+/// @brief Porzione di [0, n) assegnata a un worker nella ripartizione statica
+/// @param n Numero di elementi
+/// @param worker Indice del worker
+/// @param align I confini tra le porzioni sono multipli di align
+/// @param begin Puntatore in cui salvare il primo indice
+/// @param end Puntatore in cui salvare l'indice successivo all'ultimo
+void pool_range(size_t n, int worker, size_t align, size_t *begin, size_t *end);
+
+#endif
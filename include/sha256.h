@@ -0,0 +1,33 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// @brief Dimensione in byte di un digest SHA-256
+#define SHA256_SIZE 32
+
+/// @brief Stato di un calcolo SHA-256 incrementale
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;            // Byte elaborati
+    unsigned char block[64];    // Blocco parziale in attesa di essere elaborato
+    size_t used;
+} sha256_ctx;
+
+/// @brief Inizializza un calcolo SHA-256
+/// @param ctx Stato da inizializzare
+void sha256_init(sha256_ctx *ctx);
+
+/// @brief Aggiunge dati al calcolo
+/// @param ctx Stato inizializzato con sha256_init()
+/// @param data Dati da aggiungere
+/// @param len Numero di byte
+void sha256_update(sha256_ctx *ctx, const void *data, size_t len);
+
+/// @brief Termina il calcolo e scrive il digest
+/// @param ctx Stato (non piu' utilizzabile dopo la chiamata, se non dopo sha256_init())
+/// @param out Array di SHA256_SIZE byte in cui salvare il digest
+void sha256_final(sha256_ctx *ctx, unsigned char out[SHA256_SIZE]);
+
+#endif
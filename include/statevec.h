@@ -0,0 +1,34 @@
+#ifndef STATEVEC_H
+#define STATEVEC_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "complex.h"
+
+/// @brief Alloca un vettore di stato azzerato, con huge pages (1 GB o 2 MB) quando disponibili
+/// @param dim Numero di elementi
+/// @return Puntatore al vettore (NULL in caso di errore)
+/// Ogni worker del pool azzera (e quindi tocca per primo) la propria porzione del vettore, la stessa
+/// che gli viene assegnata dai kernel: su sistemi NUMA le pagine finiscono sul nodo del worker che le usa.
+/// "Caller must free" con statevec_free()
+complex *statevec_alloc(size_t dim);
+
+/// @brief Libera un vettore allocato con statevec_alloc()
+/// @param vec Vettore da liberare (NULL ammesso)
+void statevec_free(complex *vec);
+
+/// @brief Granularita' della ripartizione del vettore tra i worker, in elementi
+/// @param vec Vettore (anche non allocato con statevec_alloc())
+/// @param dim Numero di elementi
+/// @return Elementi di una pagina ottenuta da statevec_alloc() (4 KB, 2 MB o 1 GB), se il vettore ne contiene
+/// almeno una per worker; altrimenti (e per i vettori non allocati con statevec_alloc()) PARTITION_ALIGN
+/// I kernel dei gate devono usare questa granularita' per lavorare sulle pagine toccate per prime dallo stesso worker
+size_t statevec_align(const complex *vec, size_t dim);
+
+/// @brief Stampa il tipo di pagine ottenuto e il nodo NUMA delle pagine di ogni worker
+/// @param vec Vettore allocato con statevec_alloc()
+/// @param dim Numero di elementi
+/// @param out File su cui stampare (es. stderr)
+void statevec_report(const complex *vec, size_t dim, FILE *out);
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include <stddef.h>
+#include "complex.h"
+
+/// @brief Statistiche di un'esecuzione in streaming
+typedef struct {
+    int n_gates;            // Gate applicati
+    double first_gate_ms;   // Tempo dall'avvio al primo gate applicato
+    size_t peak_bytes;      // Massima memoria delle matrici in coda
+} stream_stats;
+
+/// @brief Carica ed esegue il circuito in streaming: un thread risolve i gate di #circ e li mette in una coda
+/// limitata, il thread chiamante li applica (con i worker del pool) e li libera appena applicati
+/// @param filename Nome del file circuito
+/// @param n_qubits Numero di qubits
+/// @param vec Stato iniziale, contiene lo stato finale al termine
+/// @param t_vec Array temp di supporto (dim elementi)
+/// @param stats Puntatore in cui salvare le statistiche (NULL se non servono)
+/// @return EXIT_FAILURE (in caso di errore nel file vec contiene uno stato parziale) o EXIT_SUCCESS
+int run_stream(const char *filename, int n_qubits, complex *vec, complex *t_vec, stream_stats *stats);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "complex.h"
+#include "gate.h"
+
+/// @brief Esegue il circuito per ogni punto di uno sweep dei parametri, distribuendo i punti sui worker,
+/// e stampa in stdout lo stato finale di ogni punto nell'ordine dei punti
+/// @param circuit Circuito gia' caricato (non viene modificato, i gate parametrici vengono ricalcolati per ogni punto)
+/// @param n_gates Numero di gate del circuito
+/// @param points Valori dei parametri per ogni punto (n_points * n_params)
+/// @param n_params Numero di parametri per punto
+/// @param n_points Numero di punti
+/// @param init_vec Stato iniziale
+/// @param n_qubits Numero di qubits
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+int run_sweep(const gate *circuit, int n_gates, const double *points, int n_params, int n_points,
+              const complex *init_vec, int n_qubits);
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef UNITARY_H
+#define UNITARY_H
+
+#include <stddef.h>
+#include "complex.h"
+#include "gate.h"
+
+/// @brief Massimo numero di qubits per la modalita' --unitary (2^12 * 2^12 complessi = 256 MB per matrice)
+#define UNITARY_MAX_QUBITS 12
+
+/// @brief Calcola la matrice unitaria dell'intero circuito (U = G_n * ... * G_1)
+/// @param circuit Circuito
+/// @param n_gates Numero di gate
+/// @param dim Dimensione del vettore di stato
+/// @param out Array di dim*dim complessi in cui salvare la matrice (per righe)
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+/// I gate GATE_MATRIX vengono moltiplicati con matmul() (a blocchi, in parallelo), gli altri gate vengono
+/// applicati dai kernel specializzati alle colonne della matrice, distribuite sui worker.
+int circuit_unitary(const gate *circuit, int n_gates, size_t dim, complex *out);
+
+/// @brief Salva una matrice unitaria su file
+/// @param path Percorso del file: se termina con ".bin" formato binario, altrimenti testo "#define U [...]"
+/// @param U Matrice (dim*dim, per righe)
+/// @param n_qubits Numero di qubits
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+/// Entrambi i formati si possono caricare come un solo gate con la direttiva #import
+int unitary_write(const char *path, const complex *U, int n_qubits);
+
+/// @brief Indica se il contenuto di un file e' una matrice in formato binario (scritta da unitary_write())
+/// @param buf Contenuto del file
+/// @param len Numero di byte
+/// @return 1 se il formato e' binario, altrimenti 0
+int unitary_is_bin(const void *buf, size_t len);
+
+/// @brief Legge una matrice in formato binario
+/// @param path Nome del file (solo per i messaggi di errore)
+/// @param buf Contenuto del file
+/// @param len Numero di byte
+/// @param n_qubits Numero di qubits atteso
+/// @param out Array di dim*dim complessi in cui salvare la matrice
+/// @return EXIT_FAILURE o EXIT_SUCCESS
+int unitary_read_bin(const char *path, const void *buf, size_t len, int n_qubits, complex *out);
+
+#endif
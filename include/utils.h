@@ -8,23 +8,25 @@
 /// @param str stringa da modificare in-place
 void trim_whitespace(char *str);
 
-/// @brief Funzione che unisce due stringhe
-/// @param dest Stringa di partenza
-/// @param src  Stringa da aggiungere alla fine della stringa di partenza
-/// @return Puntatore al nuovo indirizzo di memoria in cui è contenuta la stringa (malloc usato, caller must free)
-char *string_append(char *dest, const char *src);
-
-/// @brief Funzione che legge una riga con dimensione variabile
-/// @param fp File da cui leggere la riga
-/// @return Puntatore al buffer in cui verrà salvata la riga di testo (NULL in caso di errore) (realloc usato, caller must free)
-char *read_line(FILE *fp);
-
-/// @brief Funzione per eseguire l'operazione "matrice X vettore"
+/// @brief Tempo monotono (CLOCK_MONOTONIC) in millisecondi, per misurare intervalli
+/// @return Millisecondi da un istante di riferimento arbitrario
+double now_ms(void);
+
+/// @brief Prodotto "matrice X vettore" limitato alle righe [row_begin, row_end) del risultato
 /// @param M Array di complessi (verra' trattato come una matrice)
 /// @param in_vec Array di complessi (vettore colonna)
-/// @param out_vec Puntatore all'array dove verrà salvato il risultato
+/// @param out_vec Puntatore all'array dove verrà salvato il risultato (solo le righe richieste vengono scritte)
 /// @param dim Numero di righe == Numero di colonne della matrice
-void matvec_mul(const complex *M, const complex *in_vec, complex *out_vec, int dim);
+/// @param row_begin Prima riga da calcolare
+/// @param row_end Riga successiva all'ultima da calcolare
+void matvec_mul_rows(const complex *M, const complex *in_vec, complex *out_vec, size_t dim, size_t row_begin, size_t row_end);
+
+/// @brief Prodotto di matrici quadrate C = A * B, a blocchi e distribuito sui worker del pool
+/// @param A Matrice di sinistra (dim*dim, per righe)
+/// @param B Matrice di destra (dim*dim, per righe)
+/// @param C Matrice risultato (dim*dim), non deve coincidere con A o B
+/// @param dim Numero di righe == Numero di colonne delle matrici
+void matmul(const complex *A, const complex *B, complex *C, size_t dim);
 
 /// @brief Funzione per calcolare il valore assoluto di un float
 /// @param val Numero di cui verra' calcolato il valore assoluto
@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "arena.h"
+
+// Dimensione minima di un blocco, le allocazioni piu' grandi ricevono un blocco dedicato
+#define ARENA_BLOCK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+
+static arena_stats stats = {0, 0, 0};
+
+static size_t align_up(size_t n) {
+    return (n + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+void arena_init(arena *a) {
+    a->head = NULL;
+}
+
+void *arena_alloc(arena *a, size_t size) {
+    size = align_up(size ? size : 1);
+    arena_block *b = a->head;
+
+    if (!b || b->size - b->used < size) {
+        size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+        arena_block *nb = malloc(align_up(sizeof(arena_block)) + block_size);
+        if (!nb) return NULL;
+        nb->size = block_size;
+        nb->used = 0;
+        stats.n_blocks++;
+        stats.bytes += block_size;
+
+        // Un blocco dedicato a un'allocazione grande va dietro a quello corrente, che resta utilizzabile
+        if (b && block_size == size && b->size - b->used >= ARENA_BLOCK_SIZE / 4) {
+            nb->next = b->next;
+            b->next = nb;
+        }
+        else {
+            nb->next = b;
+            a->head = nb;
+        }
+        b = nb;
+    }
+
+    void *p = (unsigned char *)b + align_up(sizeof(arena_block)) + b->used;
+    b->used += size;
+    stats.n_allocs++;
+    return p;
+}
+
+void *arena_grow(arena *a, void *ptr, size_t old_size, size_t new_size) {
+    if (!ptr) return arena_alloc(a, new_size);
+    if (new_size <= old_size) return ptr;
+
+    // Ultima allocazione del blocco corrente: basta estenderla
+    arena_block *b = a->head;
+    unsigned char *data = (unsigned char *)b + align_up(sizeof(arena_block));
+    if ((unsigned char *)ptr + align_up(old_size ? old_size : 1) == data + b->used &&
+        align_up(new_size) - align_up(old_size ? old_size : 1) <= b->size - b->used) {
+        b->used += align_up(new_size) - align_up(old_size ? old_size : 1);
+        return ptr;
+    }
+
+    void *p = arena_alloc(a, new_size);
+    if (p) memcpy(p, ptr, old_size);
+    return p;
+}
+
+char *arena_strndup(arena *a, const char *str, size_t n) {
+    char *s = arena_alloc(a, n + 1);
+    if (!s) return NULL;
+    memcpy(s, str, n);
+    s[n] = '\0';
+    return s;
+}
+
+char *arena_read_file(arena *a, const char *filename, size_t *len_out) {
+    FILE *fp = fopen(filename, "rb");
+    if (!fp) return NULL;
+
+    struct stat st;
+    if (fstat(fileno(fp), &st) != 0) {
+        fclose(fp);
+        return NULL;
+    }
+
+    // File regolare di dimensione nota: una sola allocazione e una sola lettura.
+    // Pipe, FIFO e file speciali riportano st_size 0: si legge a blocchi facendo crescere il buffer
+    size_t capacity = S_ISREG(st.st_mode) && st.st_size > 0 ? (size_t)st.st_size : 4096;
+    char *buf = arena_alloc(a, capacity + 1);
+    if (!buf) {
+        fclose(fp);
+        return NULL;
+    }
+
+    size_t length = fread(buf, 1, capacity, fp);
+    while (length == capacity && !S_ISREG(st.st_mode) && !feof(fp) && !ferror(fp)) {
+        char *tmp = arena_grow(a, buf, capacity + 1, 2 * capacity + 1);
+        if (!tmp) {
+            fclose(fp);
+            return NULL;
+        }
+        buf = tmp;
+        capacity *= 2;
+        length += fread(buf + length, 1, capacity - length, fp);
+    }
+    int err = ferror(fp);
+    fclose(fp);
+    if (err) return NULL;
+
+    buf[length] = '\0';
+    if (len_out) *len_out = length;
+    return buf;
+}
+
+void arena_free(arena *a) {
+    arena_block *b = a->head;
+    while (b) {
+        arena_block *next = b->next;
+        free(b);
+        b = next;
+    }
+    a->head = NULL;
+}
+
+void arena_get_stats(arena_stats *out) {
+    *out = stats;
+}
@@ -0,0 +1,386 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "arena.h"
+#include "cache.h"
+#include "sha256.h"
+#include "utils.h"
+
+// Formato del file (endianness nativa, la cache non e' pensata per essere portabile):
+//   cache_header
+//   n_params  x cache_param
+//   n_records x cache_gate, seguito dal nome del gate (name_len byte, senza terminatore)
+//              in ordine anticipato: i gate di un GATE_BLOCK seguono subito il blocco
+//   padding fino a multipli di 16 byte
+//   n_mats    x matrice dim*dim di complex (una per ogni gate definito con #define, condivisa tra gli usi)
+#define CACHE_MAGIC "QCSCACHE"
+#define CACHE_VERSION 4
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_qubits;
+    unsigned char src_digest[SHA256_SIZE];  // SHA-256 del contenuto del file circuito (e dei file importati)
+    uint64_t src_size;
+    int32_t n_params;
+    int32_t n_gates;    // Gate del circuito (primo livello)
+    int32_t n_mats;
+    int32_t n_records;  // Gate totali, compresi quelli dentro ai blocchi
+} cache_header;
+
+typedef struct {
+    char name[16];
+    double value;
+} cache_param;
+
+typedef struct {
+    uint32_t name_len;
+    int32_t kind;
+    int32_t target;
+    int32_t mat_idx;    // Indice della matrice, -1 per i gate della libreria
+    int32_t arg_param[3];
+    int32_t control;
+    int32_t n_sub;      // Gate del blocco (solo GATE_BLOCK)
+    int32_t reps;       // Ripetizioni del blocco (solo GATE_BLOCK)
+    double arg_value[3];
+} cache_gate;
+
+// Percorso della cache: <filename>.qcache
+static char *cache_path(const char *filename) {
+    char *path = malloc(strlen(filename) + 8);
+    if (path) sprintf(path, "%s.qcache", filename);
+    return path;
+}
+
+// Digest SHA-256 e dimensione del contenuto del file circuito e dei file letti con #import
+// (un hash debole farebbe usare una cache vecchia senza alcun avviso)
+static int source_digest(const char *filename, unsigned char digest_out[SHA256_SIZE], uint64_t *size_out) {
+    int ret = EXIT_FAILURE;
+    arena a;
+    size_t len;
+
+    arena_init(&a);
+    char *buf = arena_read_file(&a, filename, &len);
+    if (!buf) goto cleanup;
+    sha256_ctx sha;
+    sha256_init(&sha);
+    sha256_update(&sha, buf, len);
+    uint64_t size = len;
+
+    // Una matrice importata fa parte del circuito: se il suo file cambia la cache non e' piu' valida
+    for (char *line = buf; line; line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        if (strncmp(line, "#import ", 8) != 0) continue;
+        char *p = line + 8;
+        while (*p == ' ' || *p == '\t') p++;
+        while (*p && !isspace((unsigned char)*p)) p++;
+        char *line_end = strchr(p, '\n');
+        char *path = arena_strndup(&a, p, line_end ? (size_t)(line_end - p) : strlen(p));
+        if (!path) goto cleanup;
+        trim_whitespace(path);
+
+        size_t import_len;
+        char *import_buf = arena_read_file(&a, path, &import_len);
+        if (!import_buf) goto cleanup;
+        sha256_update(&sha, import_buf, import_len);
+        size += import_len;
+    }
+
+    sha256_final(&sha, digest_out);
+    *size_out = size;
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    arena_free(&a);
+    return ret;
+}
+
+static size_t align16(size_t off) {
+    return (off + 15) & ~(size_t)15;
+}
+
+// Record dei gate da ricostruire (in ordine anticipato)
+typedef struct {
+    const cache_gate **recs;
+    int n_records;
+    int next;
+    unsigned char *mats;
+    int n_mats;
+    size_t mat_size;
+    gate_storage *storage;  // Mappatura del file: le matrici dei gate puntano direttamente qui
+    int n_qubits;
+    const param_table *params;
+} gate_reader;
+
+// Ricostruisce n gate consumando i record successivi (ricorsivamente per i blocchi)
+static int read_gates(gate_reader *r, gate *out, int n) {
+    for (int i = 0; i < n; i++) {
+        if (r->next >= r->n_records) return EXIT_FAILURE;
+        const cache_gate *cg = r->recs[r->next++];
+        gate *g = &out[i];
+        if (cg->mat_idx >= r->n_mats || cg->kind < GATE_MATRIX || cg->kind > GATE_KIND_LAST) return EXIT_FAILURE;
+
+        g->kind = cg->kind;
+        g->target = cg->target;
+        g->control = cg->control;
+        if (g->kind != GATE_MATRIX && g->kind != GATE_BLOCK &&
+            (g->target < 0 || g->target >= r->n_qubits || g->control < 0 || g->control >= r->n_qubits))
+            return EXIT_FAILURE;
+        for (int k = 0; k < 3; k++) {
+            g->args[k].param = cg->arg_param[k];
+            g->args[k].value = cg->arg_value[k];
+            if (k < gate_n_args(g->kind) && g->args[k].param >= r->params->n_params) return EXIT_FAILURE;
+        }
+
+        g->name = malloc(cg->name_len + 1);
+        if (!g->name) return EXIT_FAILURE;
+        memcpy(g->name, cg + 1, cg->name_len);
+        g->name[cg->name_len] = '\0';
+
+        if (g->kind == GATE_MATRIX) {
+            if (cg->mat_idx < 0) return EXIT_FAILURE;
+            gate_share_matrix(g, r->storage, (complex *)(r->mats + cg->mat_idx * r->mat_size));
+        }
+        else if (g->kind == GATE_BLOCK) {
+            if (cg->n_sub < 1 || cg->n_sub > r->n_records - r->next || cg->reps < 1) return EXIT_FAILURE;
+            g->sub = calloc(cg->n_sub, sizeof(gate));
+            if (!g->sub) return EXIT_FAILURE;
+            g->n_sub = cg->n_sub;
+            g->reps = cg->reps;
+            if (read_gates(r, g->sub, g->n_sub)) return EXIT_FAILURE;
+        }
+        else {
+            gate_bind(g, r->params->values);
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+int cache_load(const char *filename, int n_qubits, int *n_gates_out, gate **circuit_out, param_table *params_out) {
+    int ret = EXIT_FAILURE;
+    int fd = -1;
+    void *map = MAP_FAILED;
+    size_t map_size = 0;
+    gate_storage *storage = NULL;
+    gate *circuit = NULL;
+    int n_gates = 0;
+    const cache_gate **recs = NULL;
+    param_table params = {0, NULL, NULL};
+    size_t dim = 1UL << n_qubits;
+    size_t mat_size = dim * dim * sizeof(complex);
+
+    unsigned char src_digest[SHA256_SIZE];
+    uint64_t src_size;
+    char *path = cache_path(filename);
+    if (!path || source_digest(filename, src_digest, &src_size)) goto cleanup;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) goto cleanup;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(cache_header)) goto cleanup;
+    map_size = st.st_size;
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (map == MAP_FAILED) goto cleanup;
+
+    // Validazione della chiave: qualsiasi differenza invalida la cache
+    const unsigned char *base = map;
+    const cache_header *hdr = map;
+    if (memcmp(hdr->magic, CACHE_MAGIC, 8) != 0 || hdr->version != CACHE_VERSION ||
+        hdr->n_qubits != (uint32_t)n_qubits || memcmp(hdr->src_digest, src_digest, SHA256_SIZE) != 0 || hdr->src_size != src_size ||
+        hdr->n_params < 0 || hdr->n_gates < 0 || hdr->n_mats < 0 || hdr->n_records < 0)
+        goto cleanup;
+
+    size_t off = sizeof(cache_header);
+    if (off + hdr->n_params * sizeof(cache_param) > map_size) goto cleanup;
+    const cache_param *cparams = (const cache_param *)(base + off);
+    for (int i = 0; i < hdr->n_params; i++) {
+        char name[16];
+        memcpy(name, cparams[i].name, 16);
+        name[15] = '\0';
+        if (param_add(&params, name, cparams[i].value)) goto cleanup;
+    }
+    off += hdr->n_params * sizeof(cache_param);
+
+    // Prima passata sui gate per trovare l'inizio delle matrici
+    if (hdr->n_records < hdr->n_gates) goto cleanup;
+    recs = malloc((hdr->n_records ? hdr->n_records : 1) * sizeof(cache_gate *));
+    if (!recs) goto cleanup;
+    for (int i = 0; i < hdr->n_records; i++) {
+        if (off + sizeof(cache_gate) > map_size) goto cleanup;
+        recs[i] = (const cache_gate *)(base + off);
+        off += sizeof(cache_gate) + recs[i]->name_len;
+        off = (off + 7) & ~(size_t)7;
+    }
+    size_t mats_off = align16(off);
+    if (mats_off + hdr->n_mats * mat_size > map_size) goto cleanup;
+
+    circuit = calloc(hdr->n_gates ? hdr->n_gates : 1, sizeof(gate));
+    if (!circuit) goto cleanup;
+    n_gates = hdr->n_gates;
+
+    // La mappatura resta attiva finche' qualche gate usa una sua matrice (una sola copia per ogni #define,
+    // letta dalla page cache solo quando serve)
+    storage = gate_storage_new(map, map_size);
+    if (!storage) goto cleanup;
+    map = MAP_FAILED;
+
+    gate_reader reader = {recs, hdr->n_records, 0, (unsigned char *)base + mats_off, hdr->n_mats, mat_size, storage, n_qubits, &params};
+    if (read_gates(&reader, circuit, n_gates) || reader.next != hdr->n_records) goto cleanup;
+
+    *n_gates_out = n_gates;
+    *circuit_out = circuit;
+    *params_out = params;
+    circuit = NULL;
+    params = (param_table){0, NULL, NULL};
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (circuit) free_circuit(circuit, n_gates);
+    gate_storage_release(storage);
+    free(recs);
+    free_params(&params);
+    if (map != MAP_FAILED) munmap(map, map_size);
+    if (fd >= 0) close(fd);
+    free(path);
+    return ret;
+}
+
+// Numero di gate compresi quelli dentro ai blocchi
+static int count_records(const gate *gates, int n) {
+    int total = n;
+    for (int i = 0; i < n; i++) {
+        if (gates[i].kind == GATE_BLOCK) total += count_records(gates[i].sub, gates[i].n_sub);
+    }
+    return total;
+}
+
+// Elenca i gate in ordine anticipato (ogni blocco seguito dai suoi gate)
+static void collect_records(const gate *gates, int n, const gate **recs, int *next) {
+    for (int i = 0; i < n; i++) {
+        recs[(*next)++] = &gates[i];
+        if (gates[i].kind == GATE_BLOCK) collect_records(gates[i].sub, gates[i].n_sub, recs, next);
+    }
+}
+
+int cache_store(const char *filename, int n_qubits, const gate *circuit, int n_gates, const param_table *params) {
+    int ret = EXIT_FAILURE;
+    FILE *fp = NULL;
+    char *tmp_path = NULL;
+    const gate **recs = NULL;
+    int *mat_idx = NULL;
+    int n_mats = 0;
+    size_t dim = 1UL << n_qubits;
+    size_t mat_size = dim * dim * sizeof(complex);
+    static const char zeros[16] = {0};
+
+    unsigned char src_digest[SHA256_SIZE];
+    uint64_t src_size;
+    char *path = cache_path(filename);
+    if (!path || source_digest(filename, src_digest, &src_size)) goto cleanup;
+
+    int n_records = count_records(circuit, n_gates);
+    recs = malloc((n_records ? n_records : 1) * sizeof(gate *));
+    mat_idx = malloc((n_records ? n_records : 1) * sizeof(int));
+    if (!recs || !mat_idx) goto cleanup;
+    int next_rec = 0;
+    collect_records(circuit, n_gates, recs, &next_rec);
+
+    // Un gate definito con #define viene salvato una sola volta anche se usato piu' volte
+    for (int i = 0; i < n_records; i++) {
+        mat_idx[i] = -1;
+        if (recs[i]->kind != GATE_MATRIX) continue;
+        for (int j = 0; j < i; j++) {
+            if (recs[j]->kind == GATE_MATRIX && strcmp(recs[j]->name, recs[i]->name) == 0) {
+                mat_idx[i] = mat_idx[j];
+                break;
+            }
+        }
+        if (mat_idx[i] < 0) mat_idx[i] = n_mats++;
+    }
+
+    // Scrittura su file temporaneo e rename, cosi' un'altra esecuzione non legge mai una cache parziale
+    tmp_path = malloc(strlen(path) + 32);
+    if (!tmp_path) goto cleanup;
+    sprintf(tmp_path, "%s.%ld.tmp", path, (long)getpid());
+    fp = fopen(tmp_path, "wb");
+    if (!fp) goto cleanup;
+
+    cache_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CACHE_MAGIC, 8);
+    hdr.version = CACHE_VERSION;
+    hdr.n_qubits = n_qubits;
+    memcpy(hdr.src_digest, src_digest, SHA256_SIZE);
+    hdr.src_size = src_size;
+    hdr.n_params = params ? params->n_params : 0;
+    hdr.n_gates = n_gates;
+    hdr.n_mats = n_mats;
+    hdr.n_records = n_records;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1) goto cleanup;
+    size_t off = sizeof(hdr);
+
+    for (int i = 0; i < hdr.n_params; i++) {
+        cache_param cp;
+        memset(&cp, 0, sizeof(cp));
+        strncpy(cp.name, params->names[i], 15);
+        cp.value = params->values[i];
+        if (fwrite(&cp, sizeof(cp), 1, fp) != 1) goto cleanup;
+        off += sizeof(cp);
+    }
+
+    for (int i = 0; i < n_records; i++) {
+        const gate *g = recs[i];
+        cache_gate cg;
+        memset(&cg, 0, sizeof(cg));
+        cg.name_len = strlen(g->name);
+        cg.kind = g->kind;
+        cg.target = g->target;
+        cg.control = g->control;
+        cg.mat_idx = mat_idx[i];
+        cg.n_sub = g->n_sub;
+        cg.reps = g->reps;
+        for (int k = 0; k < 3; k++) {
+            cg.arg_param[k] = g->args[k].param;
+            cg.arg_value[k] = g->args[k].value;
+        }
+        if (fwrite(&cg, sizeof(cg), 1, fp) != 1) goto cleanup;
+        if (fwrite(g->name, 1, cg.name_len, fp) != cg.name_len) goto cleanup;
+        off += sizeof(cg) + cg.name_len;
+
+        size_t pad = ((off + 7) & ~(size_t)7) - off;
+        if (pad && fwrite(zeros, 1, pad, fp) != pad) goto cleanup;
+        off += pad;
+    }
+
+    size_t pad = align16(off) - off;
+    if (pad && fwrite(zeros, 1, pad, fp) != pad) goto cleanup;
+
+    for (int i = 0, next = 0; i < n_records; i++) {
+        if (mat_idx[i] != next) continue; // Gia' scritta (o gate senza matrice)
+        if (fwrite(recs[i]->matrix, 1, mat_size, fp) != mat_size) goto cleanup;
+        next++;
+    }
+
+    if (fclose(fp) != 0) {
+        fp = NULL;
+        goto cleanup;
+    }
+    fp = NULL;
+    if (rename(tmp_path, path) != 0) goto cleanup;
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (fp) fclose(fp);
+    if (ret != EXIT_SUCCESS && tmp_path) remove(tmp_path);
+    free(tmp_path);
+    free(recs);
+    free(mat_idx);
+    free(path);
+    return ret;
+}
@@ -0,0 +1,307 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include "checkpoint.h"
+#include "pool.h"
+
+// Formato di un checkpoint (endianness nativa): checkpoint_header seguito da dim complex
+#define CHECKPOINT_MAGIC "QCSCKPT"
+#define CHECKPOINT_VERSION 2
+
+// Lunghezza del nome di un checkpoint senza estensione: la chiave in esadecimale
+#define KEY_HEX_LEN (2 * SHA256_SIZE)
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_qubits;
+    int64_t prefix_len;
+    checkpoint_key key;     // Il nome del file e' solo un indice, fa fede la chiave salvata qui
+} checkpoint_header;
+
+// Cartella dei checkpoint: <filename>.ckpt
+static char *checkpoint_dir(const char *filename) {
+    char *path = malloc(strlen(filename) + 6);
+    if (path) sprintf(path, "%s.ckpt", filename);
+    return path;
+}
+
+// Percorso del checkpoint di una chiave: <filename>.ckpt/<chiave in esadecimale>.state
+static char *checkpoint_path(const char *filename, const checkpoint_key *key) {
+    char *path = malloc(strlen(filename) + KEY_HEX_LEN + 16);
+    if (!path) return NULL;
+    int len = sprintf(path, "%s.ckpt/", filename);
+    for (int i = 0; i < SHA256_SIZE; i++) len += sprintf(path + len, "%02x", key->digest[i]);
+    strcpy(path + len, ".state");
+    return path;
+}
+
+// Chiave dal nome di un file della cartella (<chiave in esadecimale>.state)
+static int parse_key_name(const char *name, checkpoint_key *out) {
+    if (strlen(name) != KEY_HEX_LEN + 6 || strcmp(name + KEY_HEX_LEN, ".state") != 0) return EXIT_FAILURE;
+    for (int i = 0; i < SHA256_SIZE; i++) {
+        unsigned int byte;
+        if (!isxdigit((unsigned char)name[2 * i]) || !isxdigit((unsigned char)name[2 * i + 1]) ||
+            sscanf(name + 2 * i, "%2x", &byte) != 1) return EXIT_FAILURE;
+        out->digest[i] = byte;
+    }
+    return EXIT_SUCCESS;
+}
+
+int checkpoint_exists(const char *filename) {
+    char *dir = checkpoint_dir(filename);
+    struct stat st;
+    int found = dir && stat(dir, &st) == 0 && S_ISDIR(st.st_mode);
+    free(dir);
+    return found;
+}
+
+// Digest di una matrice distinta del circuito: le occorrenze di uno stesso #define condividono la matrice
+// (gate_storage), quindi ogni definizione viene letta e hashata una sola volta
+typedef struct {
+    const complex *matrix;
+    unsigned char digest[SHA256_SIZE];
+} matrix_digest;
+
+typedef struct {
+    matrix_digest *mats;
+    size_t mat_size;
+} digest_ctx;
+
+static int compare_matrix(const void *a, const void *b) {
+    const complex *ma = ((const matrix_digest *)a)->matrix, *mb = ((const matrix_digest *)b)->matrix;
+    return ma < mb ? -1 : ma > mb;
+}
+
+// Raccoglie le matrici dei gate (compresi i gate dei blocchi), con ripetizioni
+static void collect_matrices(const gate *gates, int n, matrix_digest *out, size_t *n_out) {
+    for (int i = 0; i < n; i++) {
+        if (gates[i].kind == GATE_MATRIX) out[(*n_out)++].matrix = gates[i].matrix;
+        else if (gates[i].kind == GATE_BLOCK) collect_matrices(gates[i].sub, gates[i].n_sub, out, n_out);
+    }
+}
+
+static size_t count_matrices(const gate *gates, int n) {
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+        if (gates[i].kind == GATE_MATRIX) total++;
+        else if (gates[i].kind == GATE_BLOCK) total += count_matrices(gates[i].sub, gates[i].n_sub);
+    }
+    return total;
+}
+
+static int digest_task(size_t idx, int worker, void *arg) {
+    (void)worker;
+    digest_ctx *ctx = arg;
+    sha256_ctx sha;
+    sha256_init(&sha);
+    sha256_update(&sha, ctx->mats[idx].matrix, ctx->mat_size);
+    sha256_final(&sha, ctx->mats[idx].digest);
+    return EXIT_SUCCESS;
+}
+
+// Aggiunge all'hash il contenuto di un gate (non il nome): tipo, qubit, digest della matrice effettiva
+static void hash_gate(sha256_ctx *ctx, const gate *g, const matrix_digest *mats, size_t n_mats) {
+    int32_t kind = g->kind;
+    sha256_update(ctx, &kind, sizeof(kind));
+    switch (g->kind) {
+        case GATE_MATRIX: {
+            matrix_digest key = {g->matrix, {0}};
+            const matrix_digest *found = bsearch(&key, mats, n_mats, sizeof(matrix_digest), compare_matrix);
+            sha256_update(ctx, found->digest, SHA256_SIZE);
+            break;
+        }
+        case GATE_BLOCK: {
+            int32_t shape[2] = {g->reps, g->n_sub};
+            sha256_update(ctx, shape, sizeof(shape));
+            for (int i = 0; i < g->n_sub; i++) hash_gate(ctx, &g->sub[i], mats, n_mats);
+            break;
+        }
+        default: {
+            int32_t qubits[2] = {g->target, g->control};
+            sha256_update(ctx, qubits, sizeof(qubits));
+            // Per i gate parametrici conta la matrice calcolata, cioe' il valore dei parametri
+            if (gate_n_args(g->kind) > 0) sha256_update(ctx, g->u, sizeof(g->u));
+            break;
+        }
+    }
+}
+
+int checkpoint_keys(const complex *init_vec, int n_qubits, const gate *circuit, int n_gates, checkpoint_key *keys) {
+    size_t dim = 1UL << n_qubits;
+
+    // Matrici distinte, hashate una volta sola (in parallelo)
+    size_t n_mats = 0;
+    matrix_digest *mats = malloc((count_matrices(circuit, n_gates) + 1) * sizeof(matrix_digest));
+    if (!mats) return EXIT_FAILURE;
+    collect_matrices(circuit, n_gates, mats, &n_mats);
+    qsort(mats, n_mats, sizeof(matrix_digest), compare_matrix);
+    size_t n_distinct = 0;
+    for (size_t i = 0; i < n_mats; i++) {
+        if (n_distinct == 0 || mats[n_distinct - 1].matrix != mats[i].matrix) mats[n_distinct++] = mats[i];
+    }
+    digest_ctx dctx = {mats, dim * dim * sizeof(complex)};
+    pool_for(n_distinct, digest_task, &dctx);
+
+    uint32_t q = n_qubits;
+    sha256_ctx ctx;
+    sha256_init(&ctx);
+    sha256_update(&ctx, &q, sizeof(q));
+    sha256_update(&ctx, init_vec, dim * sizeof(complex));
+    sha256_final(&ctx, keys[0].digest);
+
+    // Catena: la chiave di un prefisso e' l'hash della chiave precedente e del gate successivo
+    for (int i = 0; i < n_gates; i++) {
+        sha256_init(&ctx);
+        sha256_update(&ctx, keys[i].digest, SHA256_SIZE);
+        hash_gate(&ctx, &circuit[i], mats, n_distinct);
+        sha256_final(&ctx, keys[i + 1].digest);
+    }
+
+    free(mats);
+    return EXIT_SUCCESS;
+}
+
+static int compare_keys(const void *a, const void *b) {
+    return memcmp(a, b, sizeof(checkpoint_key));
+}
+
+// Legge l'header di un checkpoint e controlla che corrisponda esattamente al prefisso richiesto
+static int read_header(FILE *fp, const checkpoint_key *key, int prefix_len, int n_qubits) {
+    checkpoint_header hdr;
+    int ok = fread(&hdr, sizeof(hdr), 1, fp) == 1 && memcmp(hdr.magic, CHECKPOINT_MAGIC, 8) == 0 &&
+             hdr.version == CHECKPOINT_VERSION && hdr.n_qubits == (uint32_t)n_qubits &&
+             hdr.prefix_len == prefix_len && compare_keys(&hdr.key, key) == 0;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Legge lo stato di un checkpoint dopo averne verificato l'header
+static int read_checkpoint(const char *filename, const checkpoint_key *key, int prefix_len, int n_qubits, complex *out) {
+    size_t dim = 1UL << n_qubits;
+    char *path = checkpoint_path(filename, key);
+    FILE *fp = path ? fopen(path, "rb") : NULL;
+    free(path);
+    if (!fp) return EXIT_FAILURE;
+
+    int ok = read_header(fp, key, prefix_len, n_qubits) == EXIT_SUCCESS &&
+             fread(out, sizeof(complex), dim, fp) == dim;
+    fclose(fp);
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int checkpoint_restore(const char *filename, const checkpoint_key *keys, int n_gates, int n_qubits, complex *out) {
+    int restored = 0;
+    checkpoint_key *saved = NULL;
+    size_t n_saved = 0, cap_saved = 0;
+    char *dir_path = checkpoint_dir(filename);
+    DIR *dir = dir_path ? opendir(dir_path) : NULL;
+    if (!dir) goto cleanup;
+
+    // Una sola lettura della cartella, poi ricerca binaria per ogni prefisso
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        checkpoint_key key;
+        if (parse_key_name(entry->d_name, &key)) continue;
+        if (n_saved == cap_saved) {
+            size_t new_cap = cap_saved ? cap_saved * 2 : 64;
+            checkpoint_key *new_saved = realloc(saved, new_cap * sizeof(checkpoint_key));
+            if (!new_saved) goto cleanup;
+            saved = new_saved;
+            cap_saved = new_cap;
+        }
+        saved[n_saved++] = key;
+    }
+    if (n_saved == 0) goto cleanup;
+    qsort(saved, n_saved, sizeof(checkpoint_key), compare_keys);
+
+    // Dal prefisso piu' lungo: il primo checkpoint valido e' quello che fa risparmiare piu' gate
+    for (int k = n_gates; k > 0; k--) {
+        if (!bsearch(&keys[k], saved, n_saved, sizeof(checkpoint_key), compare_keys)) continue;
+        if (read_checkpoint(filename, &keys[k], k, n_qubits, out) == EXIT_SUCCESS) {
+            restored = k;
+            break;
+        }
+    }
+
+cleanup:
+    if (dir) closedir(dir);
+    free(dir_path);
+    free(saved);
+    return restored;
+}
+
+int checkpoint_save(const char *filename, const checkpoint_key *key, int prefix_len, int n_qubits, const complex *vec) {
+    int ret = EXIT_FAILURE;
+    size_t dim = 1UL << n_qubits;
+    FILE *fp = NULL;
+    char *tmp_path = NULL;
+    char *path = checkpoint_path(filename, key);
+    char *dir = checkpoint_dir(filename);
+    if (!path || !dir) {
+        perror("Allocazione memoria fallita");
+        goto cleanup;
+    }
+
+    // Un checkpoint gia' presente si tiene solo se il suo header e' quello dello stesso prefisso,
+    // altrimenti (file danneggiato o di una versione precedente) viene riscritto
+    fp = fopen(path, "rb");
+    if (fp) {
+        int same = read_header(fp, key, prefix_len, n_qubits) == EXIT_SUCCESS;
+        fclose(fp);
+        fp = NULL;
+        if (same) {
+            ret = EXIT_SUCCESS;
+            goto cleanup;
+        }
+    }
+    if (mkdir(dir, 0777) != 0 && errno != EEXIST) {
+        perror(dir);
+        goto cleanup;
+    }
+
+    // Scrittura su file temporaneo e rename, cosi' non viene mai letto un checkpoint parziale
+    tmp_path = malloc(strlen(path) + 32);
+    if (!tmp_path) {
+        perror("Allocazione memoria fallita");
+        goto cleanup;
+    }
+    sprintf(tmp_path, "%s.%ld.tmp", path, (long)getpid());
+    fp = fopen(tmp_path, "wb");
+    if (!fp) {
+        perror(tmp_path);
+        goto cleanup;
+    }
+
+    checkpoint_header hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CHECKPOINT_MAGIC, 8);
+    hdr.version = CHECKPOINT_VERSION;
+    hdr.n_qubits = n_qubits;
+    hdr.prefix_len = prefix_len;
+    hdr.key = *key;
+    if (fwrite(&hdr, sizeof(hdr), 1, fp) != 1 || fwrite(vec, sizeof(complex), dim, fp) != dim) {
+        perror(tmp_path);
+        goto cleanup;
+    }
+
+    int err = fclose(fp);
+    fp = NULL;
+    if (err != 0 || rename(tmp_path, path) != 0) {
+        perror(path);
+        goto cleanup;
+    }
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (fp) fclose(fp);
+    if (ret != EXIT_SUCCESS && tmp_path) remove(tmp_path);
+    free(tmp_path);
+    free(path);
+    free(dir);
+    return ret;
+}
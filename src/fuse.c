@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fuse.h"
+#include "pool.h"
+#include "utils.h"
+
+typedef struct {
+    const gate *g;
+    complex *out;
+    size_t dim;
+    complex **scratch;  // Per ogni worker: vettore colonna e vettore temporaneo (2 * dim)
+} column_ctx;
+
+// Calcola la colonna j: il gate applicato al j-esimo vettore della base
+static int column_task(size_t j, int worker, void *arg) {
+    column_ctx *ctx = arg;
+    size_t dim = ctx->dim;
+    complex *vec = ctx->scratch[worker];
+    if (!vec) {
+        vec = ctx->scratch[worker] = malloc(2 * dim * sizeof(complex));
+        if (!vec) {
+            perror("Allocazione memoria fallita");
+            return EXIT_FAILURE;
+        }
+    }
+
+    memset(vec, 0, dim * sizeof(complex));
+    vec[j].re = 1.0;
+    apply_gate(ctx->g, vec, vec + dim, dim);
+    for (size_t i = 0; i < dim; i++) {
+        ctx->out[i * dim + j] = vec[i];
+    }
+    return EXIT_SUCCESS;
+}
+
+int gate_to_matrix(const gate *g, complex *out, size_t dim) {
+    if (g->kind == GATE_MATRIX) {
+        memcpy(out, g->matrix, dim * dim * sizeof(complex));
+        return EXIT_SUCCESS;
+    }
+
+    int n_workers = pool_size();
+    column_ctx ctx = {g, out, dim, calloc(n_workers, sizeof(complex *))};
+    if (!ctx.scratch) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    int ret = pool_for(dim, column_task, &ctx);
+
+    for (int i = 0; i < n_workers; i++) {
+        free(ctx.scratch[i]);
+    }
+    free(ctx.scratch);
+    return ret;
+}
+
+double gate_cost(const gate *g, size_t dim) {
+    switch (g->kind) {
+        case GATE_MATRIX:
+            return (double)dim * dim;
+        case GATE_BLOCK: {
+            double once = 0.0;
+            for (int i = 0; i < g->n_sub; i++) once += gate_cost(&g->sub[i], dim);
+            return once * g->reps;
+        }
+        default:
+            return (double)dim;
+    }
+}
+
+int block_should_fuse(const gate *g, size_t dim) {
+    if (g->kind != GATE_BLOCK || g->reps < 2) return 0;
+    if (dim > (1UL << FUSE_MAX_QUBITS) || gate_uses_params(g)) return 0;
+
+    double once = 0.0;
+    for (int i = 0; i < g->n_sub; i++) once += gate_cost(&g->sub[i], dim);
+
+    // Prodotti di matrici necessari per la potenza: quadrati + moltiplicazioni per i bit a 1
+    int n_mul = 0;
+    for (int r = g->reps; r > 1; r >>= 1) n_mul += 1 + (r & 1);
+
+    double d = (double)dim;
+    double fused = d * once + n_mul * d * d * d + d * d;   // Costruzione + potenza + applicazione
+    double plain = once * g->reps;
+    return fused < plain;
+}
+
+int block_fuse(gate *g, size_t dim) {
+    int ret = EXIT_FAILURE;
+    size_t bytes = dim * dim * sizeof(complex);
+    complex *base = malloc(bytes);
+    complex *tmp = malloc(bytes);
+    complex *acc = NULL;
+    if (!base || !tmp) {
+        perror("Allocazione memoria fallita");
+        goto cleanup;
+    }
+
+    gate once = *g;
+    once.reps = 1;
+    if (gate_to_matrix(&once, base, dim)) goto cleanup;
+
+    // Quadrati successivi: base = U^(2^k), acc accumula le potenze dei bit a 1 di reps
+    for (int r = g->reps; ; ) {
+        if (r & 1) {
+            if (!acc) {
+                acc = malloc(bytes);
+                if (!acc) {
+                    perror("Allocazione memoria fallita");
+                    goto cleanup;
+                }
+                memcpy(acc, base, bytes);
+            } else {
+                matmul(acc, base, tmp, dim);
+                complex *swap = acc; acc = tmp; tmp = swap;
+            }
+        }
+        r >>= 1;
+        if (!r) break;
+        matmul(base, base, tmp, dim);
+        complex *swap = base; base = tmp; tmp = swap;
+    }
+
+    free_circuit(g->sub, g->n_sub);
+    g->sub = NULL;
+    g->n_sub = 0;
+    g->reps = 1;
+    g->kind = GATE_MATRIX;
+    g->matrix = acc;
+    acc = NULL;
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    free(base);
+    free(tmp);
+    free(acc);
+    return ret;
+}
@@ -1,11 +1,358 @@
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+#include <sys/mman.h>
 #include "gate.h"
+#include "pool.h"
+#include "statevec.h"
+#include "utils.h"
+
+// I riferimenti possono essere rilasciati da un thread diverso da quello che li ha presi (--stream)
+static pthread_mutex_t storage_lock = PTHREAD_MUTEX_INITIALIZER;
+
+gate_storage *gate_storage_new(void *mem, size_t map_size) {
+    gate_storage *s = malloc(sizeof(gate_storage));
+    if (!s) return NULL;
+    s->refs = 1;
+    s->mem = mem;
+    s->map_size = map_size;
+    return s;
+}
+
+void gate_storage_release(gate_storage *s) {
+    if (!s) return;
+    pthread_mutex_lock(&storage_lock);
+    int last = --s->refs == 0;
+    pthread_mutex_unlock(&storage_lock);
+    if (!last) return;
+
+    if (s->map_size) munmap(s->mem, s->map_size);
+    else free(s->mem);
+    free(s);
+}
+
+void gate_share_matrix(gate *g, gate_storage *s, complex *matrix) {
+    pthread_mutex_lock(&storage_lock);
+    s->refs++;
+    pthread_mutex_unlock(&storage_lock);
+    g->storage = s;
+    g->matrix = matrix;
+}
+
+void gate_release(gate *g) {
+    free(g->name);
+    if (g->storage) gate_storage_release(g->storage);
+    else free(g->matrix);
+    free_circuit(g->sub, g->n_sub);
+    g->name = NULL;
+    g->matrix = NULL;
+    g->storage = NULL;
+    g->sub = NULL;
+    g->n_sub = 0;
+}
 
 void free_circuit(gate *circuit, int n_gates) {
     if (!circuit) return;
     for (int i = 0; i < n_gates; i++) {
-        free(circuit[i].name);
-        free(circuit[i].matrix);
+        gate_release(&circuit[i]);
     }
     free(circuit);
-}
\ No newline at end of file
+}
+
+int gate_n_args(gate_kind kind) {
+    switch (kind) {
+        case GATE_RX:
+        case GATE_RY:
+        case GATE_RZ:
+            return 1;
+        case GATE_U3:
+            return 3;
+        default:
+            return 0;
+    }
+}
+
+int gate_n_qubits(gate_kind kind) {
+    switch (kind) {
+        case GATE_MATRIX:
+        case GATE_BLOCK:
+            return 0;
+        case GATE_CNOT:
+        case GATE_SWAP:
+        case GATE_CZ:
+            return 2;
+        default:
+            return 1;
+    }
+}
+
+// Valore effettivo di un argomento (costante o parametro)
+static double arg_value(gate_arg arg, const double *values) {
+    return arg.param < 0 ? arg.value : values[arg.param];
+}
+
+// Restituisce e^(i*phi)
+static complex complex_expi(double phi) {
+    complex c = {cos(phi), sin(phi)};
+    return c;
+}
+
+int gate_uses_params(const gate *g) {
+    if (g->kind == GATE_BLOCK) {
+        for (int i = 0; i < g->n_sub; i++) {
+            if (gate_uses_params(&g->sub[i])) return 1;
+        }
+        return 0;
+    }
+    for (int k = 0; k < gate_n_args(g->kind); k++) {
+        if (g->args[k].param >= 0) return 1;
+    }
+    return 0;
+}
+
+void gate_bind(gate *g, const double *values) {
+    if (g->kind == GATE_BLOCK) {
+        for (int i = 0; i < g->n_sub; i++) gate_bind(&g->sub[i], values);
+        return;
+    }
+    if (gate_n_args(g->kind) == 0) return;
+
+    double theta = arg_value(g->args[0], values);
+    double c = cos(theta / 2.0), s = sin(theta / 2.0);
+    complex *u = g->u;
+
+    switch (g->kind) {
+        case GATE_RX:
+            u[0] = (complex){c, 0.0};  u[1] = (complex){0.0, -s};
+            u[2] = (complex){0.0, -s}; u[3] = (complex){c, 0.0};
+            break;
+        case GATE_RY:
+            u[0] = (complex){c, 0.0}; u[1] = (complex){-s, 0.0};
+            u[2] = (complex){s, 0.0}; u[3] = (complex){c, 0.0};
+            break;
+        case GATE_RZ:
+            u[0] = complex_expi(-theta / 2.0); u[1] = (complex){0.0, 0.0};
+            u[2] = (complex){0.0, 0.0};        u[3] = complex_expi(theta / 2.0);
+            break;
+        case GATE_U3: {
+            double phi = arg_value(g->args[1], values);
+            double lambda = arg_value(g->args[2], values);
+            complex e_l = complex_expi(lambda), e_p = complex_expi(phi), e_pl = complex_expi(phi + lambda);
+            u[0] = (complex){c, 0.0};
+            u[1] = (complex){-s * e_l.re, -s * e_l.im};
+            u[2] = (complex){s * e_p.re, s * e_p.im};
+            u[3] = (complex){c * e_pl.re, c * e_pl.im};
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+// Kernel specializzati: agiscono in-place sul vettore toccando solo gli elementi necessari.
+// Ogni kernel lavora su un intervallo [k0, k1) di indici "compressi" (indici del vettore a cui sono
+// stati tolti i bit dei qubit del gate), cosi' il lavoro si divide tra i worker senza sovrapposizioni.
+
+// Sotto questa quantita' di lavoro (elementi toccati) il gate viene applicato in modo seriale
+#define PARALLEL_KERNEL_MIN (1UL << 16)
+
+// Inserisce un bit a 0 nella posizione di "mask" dentro a k
+static inline size_t insert_zero(size_t k, size_t mask) {
+    return ((k & ~(mask - 1)) << 1) | (k & (mask - 1));
+}
+
+// Come insert_zero() ma per due bit (mask_a != mask_b)
+static inline size_t insert_zero2(size_t k, size_t mask_a, size_t mask_b) {
+    size_t lo = mask_a < mask_b ? mask_a : mask_b;
+    size_t hi = mask_a < mask_b ? mask_b : mask_a;
+    return insert_zero(insert_zero(k, lo), hi);
+}
+
+static inline void kernel_x(complex *vec, size_t k0, size_t k1, size_t mask) {
+    for (size_t k = k0; k < k1; k++) {
+        size_t i0 = insert_zero(k, mask), i1 = i0 | mask;
+        complex t = vec[i0];
+        vec[i0] = vec[i1];
+        vec[i1] = t;
+    }
+}
+
+static inline void kernel_y(complex *vec, size_t k0, size_t k1, size_t mask) {
+    // [a, b] -> [-i*b, i*a]
+    for (size_t k = k0; k < k1; k++) {
+        size_t i0 = insert_zero(k, mask), i1 = i0 | mask;
+        complex a = vec[i0], b = vec[i1];
+        vec[i0] = (complex){b.im, -b.re};
+        vec[i1] = (complex){-a.im, a.re};
+    }
+}
+
+static inline void kernel_z(complex *vec, size_t k0, size_t k1, size_t mask) {
+    for (size_t k = k0; k < k1; k++) {
+        size_t i1 = insert_zero(k, mask) | mask;
+        vec[i1].re = -vec[i1].re;
+        vec[i1].im = -vec[i1].im;
+    }
+}
+
+// Moltiplica per "phase" gli elementi con il bit di "mask" a 1 (S, T)
+static inline void kernel_phase(complex *vec, size_t k0, size_t k1, size_t mask, complex phase) {
+    for (size_t k = k0; k < k1; k++) {
+        size_t i1 = insert_zero(k, mask) | mask;
+        vec[i1] = complex_mul(vec[i1], phase);
+    }
+}
+
+static inline void kernel_h(complex *vec, size_t k0, size_t k1, size_t mask) {
+    const double scale = 0.70710678118654752440; // 1/sqrt(2)
+    for (size_t k = k0; k < k1; k++) {
+        size_t i0 = insert_zero(k, mask), i1 = i0 | mask;
+        complex a = vec[i0], b = vec[i1];
+        vec[i0] = (complex){(a.re + b.re) * scale, (a.im + b.im) * scale};
+        vec[i1] = (complex){(a.re - b.re) * scale, (a.im - b.im) * scale};
+    }
+}
+
+static inline void kernel_cnot(complex *vec, size_t k0, size_t k1, size_t ctrl_mask, size_t mask) {
+    for (size_t k = k0; k < k1; k++) {
+        size_t i0 = insert_zero2(k, ctrl_mask, mask) | ctrl_mask, i1 = i0 | mask;
+        complex t = vec[i0];
+        vec[i0] = vec[i1];
+        vec[i1] = t;
+    }
+}
+
+static inline void kernel_swap(complex *vec, size_t k0, size_t k1, size_t mask_a, size_t mask_b) {
+    // Scambia |..1..0..> con |..0..1..>
+    for (size_t k = k0; k < k1; k++) {
+        size_t base = insert_zero2(k, mask_a, mask_b);
+        size_t ia = base | mask_a, ib = base | mask_b;
+        complex t = vec[ia];
+        vec[ia] = vec[ib];
+        vec[ib] = t;
+    }
+}
+
+static inline void kernel_cz(complex *vec, size_t k0, size_t k1, size_t mask_a, size_t mask_b) {
+    for (size_t k = k0; k < k1; k++) {
+        size_t i11 = insert_zero2(k, mask_a, mask_b) | mask_a | mask_b;
+        vec[i11].re = -vec[i11].re;
+        vec[i11].im = -vec[i11].im;
+    }
+}
+
+// Gate generico su un qubit (matrice 2x2 per righe)
+static inline void kernel_u(complex *vec, size_t k0, size_t k1, size_t mask, const complex *u) {
+    for (size_t k = k0; k < k1; k++) {
+        size_t i0 = insert_zero(k, mask), i1 = i0 | mask;
+        complex a = vec[i0], b = vec[i1];
+        vec[i0] = complex_add(complex_mul(u[0], a), complex_mul(u[1], b));
+        vec[i1] = complex_add(complex_mul(u[2], a), complex_mul(u[3], b));
+    }
+}
+
+// Numero di indici compressi su cui lavora il gate (righe per GATE_MATRIX)
+static size_t gate_work(const gate *g, size_t dim) {
+    return g->kind == GATE_MATRIX ? dim : dim >> gate_n_qubits(g->kind);
+}
+
+// Applica il gate agli indici compressi [k0, k1).
+// Per GATE_MATRIX: step 0 calcola le righe in t_vec, step 1 le ricopia in vec (dopo che tutte le righe sono state calcolate)
+static void apply_range(const gate *g, complex *vec, complex *t_vec, size_t dim, size_t k0, size_t k1, int step) {
+    size_t mask = 1UL << g->target;
+    size_t ctrl_mask = 1UL << g->control;
+
+    switch (g->kind) {
+        case GATE_MATRIX:
+            if (step == 0) matvec_mul_rows(g->matrix, vec, t_vec, dim, k0, k1);
+            else memcpy(vec + k0, t_vec + k0, (k1 - k0) * sizeof(complex));
+            break;
+        case GATE_RX:
+        case GATE_RY:
+        case GATE_RZ:
+        case GATE_U3:
+            kernel_u(vec, k0, k1, mask, g->u);
+            break;
+        case GATE_X:
+            kernel_x(vec, k0, k1, mask);
+            break;
+        case GATE_Y:
+            kernel_y(vec, k0, k1, mask);
+            break;
+        case GATE_Z:
+            kernel_z(vec, k0, k1, mask);
+            break;
+        case GATE_HADAMARD:
+            kernel_h(vec, k0, k1, mask);
+            break;
+        case GATE_S:
+            kernel_phase(vec, k0, k1, mask, (complex){0.0, 1.0});
+            break;
+        case GATE_T:
+            kernel_phase(vec, k0, k1, mask, (complex){0.70710678118654752440, 0.70710678118654752440});
+            break;
+        case GATE_CNOT:
+            kernel_cnot(vec, k0, k1, ctrl_mask, mask);
+            break;
+        case GATE_SWAP:
+            kernel_swap(vec, k0, k1, ctrl_mask, mask);
+            break;
+        case GATE_CZ:
+            kernel_cz(vec, k0, k1, ctrl_mask, mask);
+            break;
+        case GATE_BLOCK:
+            break; // Gestito da apply_gate()
+    }
+}
+
+typedef struct {
+    const gate *g;
+    complex *vec;
+    complex *t_vec;
+    size_t dim;
+    size_t align;   // Granularita' della ripartizione del vettore (statevec_align())
+    int step;
+} apply_ctx;
+
+// Porzione del worker: la stessa ripartizione usata da statevec_alloc() per il first touch
+static int apply_task(size_t idx, int worker, void *arg) {
+    (void)idx;
+    apply_ctx *ctx = arg;
+    size_t work = gate_work(ctx->g, ctx->dim);
+    size_t align = ctx->align * work / ctx->dim;
+    size_t k0, k1;
+    pool_range(work, worker, align ? align : 1, &k0, &k1);
+    if (k0 < k1) apply_range(ctx->g, ctx->vec, ctx->t_vec, ctx->dim, k0, k1, ctx->step);
+    return EXIT_SUCCESS;
+}
+
+void apply_gate(const gate *g, complex *vec, complex *t_vec, size_t dim) {
+    // Blocco ripetuto: lo stesso piano (la lista di gate) viene riapplicato senza copie
+    if (g->kind == GATE_BLOCK) {
+        for (int r = 0; r < g->reps; r++) apply_circuit(g->sub, g->n_sub, vec, t_vec, dim);
+        return;
+    }
+
+    size_t work = gate_work(g, dim);
+    size_t cost = g->kind == GATE_MATRIX ? dim * dim : dim;
+
+    if (cost < PARALLEL_KERNEL_MIN || pool_size() == 1) {
+        apply_range(g, vec, t_vec, dim, 0, work, 0);
+        if (g->kind == GATE_MATRIX) apply_range(g, vec, t_vec, dim, 0, work, 1);
+        return;
+    }
+
+    apply_ctx ctx = {g, vec, t_vec, dim, statevec_align(vec, dim), 0};
+    pool_static(apply_task, &ctx);
+    if (g->kind == GATE_MATRIX) {
+        ctx.step = 1;
+        pool_static(apply_task, &ctx);
+    }
+}
+
+void apply_circuit(const gate *circuit, int n_gates, complex *vec, complex *t_vec, size_t dim) {
+    for (int i = 0; i < n_gates; i++) {
+        apply_gate(&circuit[i], vec, t_vec, dim);
+    }
+}
@@ -3,43 +3,62 @@
 #include <string.h>
 #include <errno.h>
 #include <ctype.h>
+#include <limits.h>
+#include "arena.h"
+#include "fuse.h"
 #include "loader.h"
 #include "parser.h"
+#include "pool.h"
+#include "statevec.h"
+#include "unitary.h"
 #include "utils.h"
 
+// Restituisce la prossima riga del buffer, terminata in-place al posto di '\n' (NULL a fine buffer)
+static char *next_line(char **cursor) {
+    char *line = *cursor;
+    if (*line == '\0') return NULL;
+    char *end = strchr(line, '\n');
+    if (end) {
+        *end = '\0';
+        *cursor = end + 1;
+    }
+    else {
+        *cursor = line + strlen(line);
+    }
+    return line;
+}
+
 int load_qubits_init(const char *filename, int *n_qubits, complex **out_vec) {
-    FILE *fp = fopen(filename, "r");
+    int ret = EXIT_FAILURE;
+    arena a;
     int qubits = 0;
     unsigned char done_qubits = 0, done_init = 0;
     char *init_buf = NULL;
     int idx_line = 1;
-    char *line = NULL;
+    complex *vec = NULL;
 
-    if (!fp) {
+    arena_init(&a);
+    char *cursor = arena_read_file(&a, filename, NULL);
+    if (!cursor) {
         perror(filename);
-        return EXIT_FAILURE;
+        goto cleanup;
     }
 
-    while ((line = read_line(fp)) != NULL) {
+    char *line;
+    while ((line = next_line(&cursor)) != NULL) {
         if (!done_qubits && strncmp(line, "#qubits ", 8) == 0) {
             char *num_start = line + 7;
             errno = 0;
             char *endptr = NULL;
             qubits = strtol(num_start, &endptr, 10);
 
-            if (errno != 0 || endptr == num_start || (*endptr != '\0' && *endptr != '\n' && *endptr != '\r')) {
+            if (errno != 0 || endptr == num_start || (*endptr != '\0' && *endptr != '\r')) {
                 fprintf(stderr, "Errore in %s, riga %d: Parsing numero fallito (%s)\n", filename, idx_line, strerror(errno));
-                if (init_buf) free(init_buf);
-                free(line);
-                fclose(fp);
-                return EXIT_FAILURE;
+                goto cleanup;
             }
             if (qubits < 1 || qubits > 30) {
                 fprintf(stderr, "Errore in %s, riga %d: Numero qubits non valido (0<x<31)\n", filename, idx_line);
-                if (init_buf) free(init_buf);
-                free(line);
-                fclose(fp);
-                return EXIT_FAILURE;
+                goto cleanup;
             }
             done_qubits = 1;
         }
@@ -49,270 +68,820 @@ int load_qubits_init(const char *filename, int *n_qubits, complex **out_vec) {
             char *rbr = strchr(line, ']');
             if (!lbr || !rbr || rbr < lbr) {
                 fprintf(stderr, "Errore in %s, riga %d: Parentesi quadre malformate\n", filename, idx_line);
-                free(line);
-                fclose(fp);
-                return EXIT_FAILURE;
+                goto cleanup;
             }
 
-            size_t len = rbr - lbr - 1;
-            init_buf = malloc(len + 1);
-            if (!init_buf) {
-                perror("Allocazione memoria fallita");
-                free(line);
-                fclose(fp);
-                return EXIT_FAILURE;
-            }
-            strncpy(init_buf, lbr + 1, len);
-            init_buf[len] = '\0';
+            // Il contenuto tra parentesi viene usato direttamente dal buffer del file
+            *rbr = '\0';
+            init_buf = lbr + 1;
             done_init = 1;
         }
 
-        free(line);
         if (done_qubits && done_init) break;
         idx_line++;
     }
-    fclose(fp);
 
     if (!done_qubits) {
         fprintf(stderr, "Errore in %s: Numero qubits mancante\n", filename);
-        if (init_buf) free(init_buf);
-        return EXIT_FAILURE;
+        goto cleanup;
     }
     if (!done_init) {
         fprintf(stderr, "Errore in %s: Vettore init mancante\n", filename);
-        free(init_buf);
-        return EXIT_FAILURE;
+        goto cleanup;
     }
 
     size_t dim = 1 << qubits;
     size_t idx = 0;
-    complex *vec = malloc(dim * sizeof(complex));
+    vec = statevec_alloc(dim); // Pagine gia' distribuite tra i worker, il parsing scrive soltanto
     if (!vec) {
         perror("Allocazione memoria fallita");
-        free(init_buf);
-        return EXIT_FAILURE;
+        goto cleanup;
     }
 
-    char *tkn = strtok(init_buf, ",");
+    char *saveptr;
+    char *tkn = strtok_r(init_buf, ",", &saveptr);
     while (tkn) {
         if (idx == dim) {
             fprintf(stderr, "Errore in %s: Elementi di #init superiori al necessario\n", filename);
-            free(vec);
-            free(init_buf);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
         trim_whitespace(tkn);
         if (parse_complex(tkn, &vec[idx])) {
             fprintf(stderr, "Errore in %s: Parsing numero fallito (%s)\n", filename, tkn);
-            free(vec);
-            free(init_buf);
-            return EXIT_FAILURE;
+            goto cleanup;
         }
         idx++;
-        tkn = strtok(NULL, ",");
+        tkn = strtok_r(NULL, ",", &saveptr);
     }
-    free(init_buf);
 
     if (idx < dim) {
         fprintf(stderr, "Errore in %s: Elementi di #init inferiori al necessario\n", filename);
-        free(vec);
-        return EXIT_FAILURE;
+        goto cleanup;
     }
 
     *out_vec = vec;
     *n_qubits = qubits;
+    vec = NULL;
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    statevec_free(vec);
+    arena_free(&a);
+    return ret;
+}
+
+// Estrae il prossimo token del circuito (separato da spazi, senza spezzare le parentesi tonde)
+// Il token viene terminato in-place, NULL se non ci sono altri token
+static char *next_circ_token(char **cursor) {
+    char *p = *cursor;
+    while (isspace((unsigned char)*p)) p++;
+    if (*p == '\0') {
+        *cursor = p;
+        return NULL;
+    }
+
+    char *start = p;
+    int depth = 0;
+    while (*p && (depth > 0 || !isspace((unsigned char)*p))) {
+        if (*p == '(') depth++;
+        else if (*p == ')' && depth > 0) depth--;
+        p++;
+    }
+    if (*p) *p++ = '\0';
+    *cursor = p;
+    return start;
+}
+
+// Divide una lista di gate (riga di #circ o #subcirc) in token terminati in-place, array allocato nell'arena
+static int tokenize_circ(arena *a, char *text, char ***tokens_out, int *n_out) {
+    char **tokens = NULL;
+    int n_tokens = 0, cap_tokens = 0;
+    char *cursor = text;
+    char *token = next_circ_token(&cursor);
+    while (token) {
+        if (n_tokens == cap_tokens) {
+            int new_cap = cap_tokens ? cap_tokens * 2 : 64;
+            char **new_tokens = arena_grow(a, tokens, cap_tokens * sizeof(char *), new_cap * sizeof(char *));
+            if (!new_tokens) return EXIT_FAILURE;
+            tokens = new_tokens;
+            cap_tokens = new_cap;
+        }
+        tokens[n_tokens++] = token;
+        token = next_circ_token(&cursor);
+    }
+    *tokens_out = tokens;
+    *n_out = n_tokens;
+    return EXIT_SUCCESS;
+}
+
+// Parsing di un gate della libreria nella forma NOME(arg, ..., qubit, ...), es. H(0), CNOT(0, 1), RX(theta, 0) o U3(0.1, phi, 0, 2)
+static int parse_builtin_gate(arena *a, const char *filename, const char *token, const param_table *params, const int n_qubits, gate *out) {
+    static const struct { const char *name; gate_kind kind; } families[] = {
+        {"RX", GATE_RX}, {"RY", GATE_RY}, {"RZ", GATE_RZ}, {"U3", GATE_U3},
+        {"X", GATE_X}, {"Y", GATE_Y}, {"Z", GATE_Z}, {"H", GATE_HADAMARD}, {"S", GATE_S}, {"T", GATE_T},
+        {"CNOT", GATE_CNOT}, {"SWAP", GATE_SWAP}, {"CZ", GATE_CZ}
+    };
+
+    const char *lpar = strchr(token, '(');
+    const char *rpar = strrchr(token, ')');
+    if (!lpar || !rpar || rpar < lpar || rpar[1] != '\0') {
+        fprintf(stderr, "Errore in %s: Parentesi tonde malformate (%s)\n", filename, token);
+        return EXIT_FAILURE;
+    }
+
+    out->kind = GATE_MATRIX;
+    for (size_t i = 0; i < sizeof(families) / sizeof(families[0]); i++) {
+        if (strlen(families[i].name) == (size_t)(lpar - token) && strncmp(token, families[i].name, lpar - token) == 0) {
+            out->kind = families[i].kind;
+            break;
+        }
+    }
+    if (out->kind == GATE_MATRIX) {
+        fprintf(stderr, "Errore in %s: Gate della libreria sconosciuto (%s)\n", filename, token);
+        return EXIT_FAILURE;
+    }
+
+    char *args = arena_strndup(a, lpar + 1, rpar - lpar - 1);
+    if (!args) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    int n_args = gate_n_args(out->kind);
+    int n_gate_qubits = gate_n_qubits(out->kind);
+    int qubits[2];
+    int idx = 0;
+    char *saveptr;
+    char *tkn = strtok_r(args, ",", &saveptr);
+    while (tkn) {
+        trim_whitespace(tkn);
+        if (idx < n_args) {
+            // Argomento numerico o nome di un #param
+            out->args[idx].param = -1;
+            if (parse_real(tkn, &out->args[idx].value)) {
+                out->args[idx].param = param_find(params, tkn);
+                if (out->args[idx].param < 0) {
+                    fprintf(stderr, "Errore in %s: Parametro non definito (%s in %s)\n", filename, tkn, token);
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        else if (idx < n_args + n_gate_qubits) {
+            // Argomenti finali: qubit su cui agisce il gate
+            char *endptr = NULL;
+            errno = 0;
+            long qubit = strtol(tkn, &endptr, 10);
+            if (errno != 0 || endptr == tkn || *endptr != '\0' || qubit < 0 || qubit >= n_qubits) {
+                fprintf(stderr, "Errore in %s: Qubit non valido (%s in %s)\n", filename, tkn, token);
+                return EXIT_FAILURE;
+            }
+            qubits[idx - n_args] = (int)qubit;
+        }
+        idx++;
+        tkn = strtok_r(NULL, ",", &saveptr);
+    }
+
+    if (idx != n_args + n_gate_qubits) {
+        fprintf(stderr, "Errore in %s: Numero di argomenti errato (%s, attesi %d)\n", filename, token, n_args + n_gate_qubits);
+        return EXIT_FAILURE;
+    }
+
+    // Per i gate a due qubit il primo e' il controllo (CNOT/CZ) e l'ultimo il target
+    out->target = qubits[n_gate_qubits - 1];
+    out->control = qubits[0];
+    if (n_gate_qubits == 2 && out->control == out->target) {
+        fprintf(stderr, "Errore in %s: Qubit ripetuto (%s)\n", filename, token);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Definizione di un gate indicizzata durante la prima fase (la matrice viene letta solo se il gate e' usato)
+typedef struct {
+    char name[16];
+    char *mat_start;  // Primo carattere dopo '[' (il testo e' terminato in-place al posto di ']')
+    int line;         // Riga della direttiva, per i messaggi di errore
+    complex *matrix;  // NULL finche' il gate non viene usato nel circuito
+    gate_storage *storage; // Proprietaria di matrix, condivisa da tutti gli usi del gate
+    char *import;     // File da cui leggere la matrice (#import), NULL per #define
+} gate_def;
+
+// Righe di una matrice da convertire, suddivise in blocchi tra i worker
+typedef struct {
+    const char *filename;
+    int line;
+    char **rows;            // Contenuto di ogni riga (tra parentesi tonde), terminato in-place
+    size_t dim;
+    size_t rows_per_task;
+    complex *matrix;
+} rows_ctx;
+
+// Sotto questa dimensione (elementi della matrice) il parsing resta seriale
+#define PARALLEL_PARSE_MIN 4096
+
+// Parsing di un blocco di righe della matrice
+static int parse_rows(size_t task, int worker, void *arg) {
+    (void)worker;
+    rows_ctx *ctx = arg;
+    size_t first = task * ctx->rows_per_task;
+    size_t last = first + ctx->rows_per_task;
+    if (last > ctx->dim) last = ctx->dim;
+
+    for (size_t row_idx = first; row_idx < last; row_idx++) {
+        complex *row = ctx->matrix + row_idx * ctx->dim;
+        size_t col = 0;
+        char *saveptr;
+        char *tkn = strtok_r(ctx->rows[row_idx], ",", &saveptr);
+        while (tkn) {
+            trim_whitespace(tkn); // Il parser accetta solo input sanificato
+            if (col == ctx->dim) {
+                fprintf(stderr, "Errore in %s, riga %d: Elementi della riga %zu superiori al necessario\n", ctx->filename, ctx->line, row_idx);
+                return EXIT_FAILURE;
+            }
+            if (parse_complex(tkn, &row[col])) {
+                fprintf(stderr, "Errore in %s, riga %d: Parsing fallito (%s)\n", ctx->filename, ctx->line, tkn);
+                return EXIT_FAILURE;
+            }
+            col++;
+            tkn = strtok_r(NULL, ",", &saveptr);
+        }
+        if (col < ctx->dim) {
+            fprintf(stderr, "Errore in %s, riga %d: Elementi della riga %zu inferiori al necessario\n", ctx->filename, ctx->line, row_idx);
+            return EXIT_FAILURE;
+        }
+    }
+    return EXIT_SUCCESS;
+}
+
+// Legge il file di un gate importato: matrice binaria (letta direttamente) oppure primo #define del file
+// (il nome nel file viene ignorato, mat_start e line vengono impostati per il parsing normale)
+static int read_import(arena *a, gate_def *def, size_t dim) {
+    size_t len;
+    char *buf = arena_read_file(a, def->import, &len);
+    if (!buf) {
+        perror(def->import);
+        return EXIT_FAILURE;
+    }
+
+    if (unitary_is_bin(buf, len)) {
+        int n_qubits = 0;
+        while ((1UL << n_qubits) < dim) n_qubits++;
+        complex *matrix = malloc(dim * dim * sizeof(complex));
+        if (!matrix) {
+            perror("Allocazione memoria fallita");
+            return EXIT_FAILURE;
+        }
+        if (unitary_read_bin(def->import, buf, len, n_qubits, matrix)) {
+            free(matrix);
+            return EXIT_FAILURE;
+        }
+        def->matrix = matrix;
+        return EXIT_SUCCESS;
+    }
+
+    char *define = strstr(buf, "#define ");
+    char *open_bracket = define ? strchr(define, '[') : NULL;
+    char *close_bracket = open_bracket ? strchr(open_bracket, ']') : NULL;
+    if (!close_bracket) {
+        fprintf(stderr, "Errore in %s: Nessun #define con parentesi quadre valide\n", def->import);
+        return EXIT_FAILURE;
+    }
+    *close_bracket = '\0';
+    def->mat_start = open_bracket + 1;
+    def->line = 1;
+    for (char *p = buf; p < define; p++) if (*p == '\n') def->line++;
+    return EXIT_SUCCESS;
+}
+
+// Seconda fase: parsing della matrice di un gate usato nel circuito (def->matrix allocata con malloc)
+static int parse_gate_def(arena *a, const char *filename, gate_def *def, size_t dim) {
+    // Gate importato: il file viene letto solo ora, gli errori si riferiscono a quel file
+    if (def->import) {
+        filename = def->import;
+        if (read_import(a, def, dim)) return EXIT_FAILURE;
+        if (def->matrix) return EXIT_SUCCESS;
+    }
+
+    char **rows = arena_alloc(a, dim * sizeof(char *));
+    if (!rows) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    // Individua le righe (scansione seriale, molto piu' veloce della conversione dei numeri)
+    char *p_mat_buf = def->mat_start;
+    for (size_t row_idx = 0; row_idx < dim; row_idx++) {
+        char *row_lbr = strchr(p_mat_buf, '(');
+        char *row_rbr = strchr(p_mat_buf, ')');
+        if (!row_lbr || !row_rbr || row_rbr < row_lbr) {
+            fprintf(stderr, "Errore in %s, riga %d: Parentesi tonde malformate\n", filename, def->line);
+            return EXIT_FAILURE;
+        }
+        *row_rbr = '\0';
+        rows[row_idx] = row_lbr + 1;
+        p_mat_buf = row_rbr + 1;
+    }
+
+    complex *t_mat = malloc(dim * dim * sizeof(complex));
+    if (!t_mat) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    rows_ctx ctx;
+    ctx.filename = filename;
+    ctx.line = def->line;
+    ctx.rows = rows;
+    ctx.dim = dim;
+    ctx.matrix = t_mat;
+
+    // Matrici grandi: blocchi di righe convertiti in parallelo (qualche blocco per worker per bilanciare il carico)
+    int ret;
+    if (dim * dim >= PARALLEL_PARSE_MIN && pool_size() > 1) {
+        size_t n_tasks = (size_t)pool_size() * 4;
+        if (n_tasks > dim) n_tasks = dim;
+        ctx.rows_per_task = (dim + n_tasks - 1) / n_tasks;
+        ret = pool_for((dim + ctx.rows_per_task - 1) / ctx.rows_per_task, parse_rows, &ctx);
+    }
+    else {
+        ctx.rows_per_task = dim;
+        ret = parse_rows(0, 0, &ctx);
+    }
+
+    if (ret != EXIT_SUCCESS) {
+        free(t_mat);
+        return EXIT_FAILURE;
+    }
+    def->matrix = t_mat;
+    return EXIT_SUCCESS;
+}
+
+// Sotto-circuito dichiarato con #subcirc (i token vengono risolti a ogni utilizzo)
+typedef struct {
+    char name[16];
+    char **tokens;
+    int n_tokens;
+} subcirc_def;
+
+// Massimo annidamento dei sotto-circuiti (oltre si assume una definizione ricorsiva)
+#define MAX_SUBCIRC_DEPTH 16
+
+// Blocco ripetuto gia' fuso in una matrice: le altre occorrenze dello stesso token la condividono
+typedef struct {
+    const char *token;      // Token completo (es. "B^200"), nel buffer del file
+    gate_storage *storage;
+    complex *matrix;
+} fused_block;
+
+typedef struct {
+    fused_block *blocks;    // Allocati nell'arena
+    int n;
+    int cap;
+} fused_list;
+
+// Stato della seconda fase: risoluzione dei token del circuito in gate
+typedef struct {
+    arena *a;
+    const char *filename;
+    gate_def *defs;
+    int n_defs;
+    subcirc_def *subs;
+    int n_subs;
+    const param_table *params;
+    int n_qubits;
+    size_t dim;
+    fused_list *fused;
+} resolve_ctx;
+
+// Lista di gate in uscita (malloc, sopravvive al caricamento): cresce raddoppiando
+typedef struct {
+    gate *gates;
+    int n;
+    int cap;
+} gate_list;
+
+// Riserva spazio per "extra" gate in fondo alla lista
+static int gate_list_reserve(gate_list *list, int extra) {
+    if (list->n + extra <= list->cap) return EXIT_SUCCESS;
+    int new_cap = list->cap ? list->cap : 16;
+    while (new_cap < list->n + extra) new_cap *= 2;
+    gate *new_gates = realloc(list->gates, new_cap * sizeof(gate));
+    if (!new_gates) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+    list->gates = new_gates;
+    list->cap = new_cap;
+    return EXIT_SUCCESS;
+}
+
+// Aggiunge un gate azzerato in fondo alla lista (NULL in caso di errore)
+static gate *gate_list_push(gate_list *list) {
+    if (gate_list_reserve(list, 1)) return NULL;
+    gate *g = &list->gates[list->n++];
+    memset(g, 0, sizeof(gate));
+    return g;
+}
+
+static subcirc_def *find_subcirc(const resolve_ctx *ctx, const char *name) {
+    for (int i = 0; i < ctx->n_subs; i++) {
+        if (strcmp(ctx->subs[i].name, name) == 0) return &ctx->subs[i];
+    }
+    return NULL;
+}
+
+// Risolve un singolo gate (della libreria o definito con #define) e lo aggiunge alla lista
+static int resolve_gate(resolve_ctx *ctx, const char *token, gate_list *list) {
+    gate *g = gate_list_push(list);
+    if (!g) return EXIT_FAILURE;
+
+    // Gate della libreria: nessuna matrice, viene applicato dal kernel specializzato
+    if (strchr(token, '(')) {
+        if (parse_builtin_gate(ctx->a, ctx->filename, token, ctx->params, ctx->n_qubits, g))
+            return EXIT_FAILURE;
+
+        g->name = strdup(token);
+        if (!g->name) {
+            perror("Allocazione memoria fallita");
+            return EXIT_FAILURE;
+        }
+        gate_bind(g, ctx->params->values);
+        return EXIT_SUCCESS;
+    }
+
+    gate_def *def = NULL;
+    for (int j = 0; j < ctx->n_defs; j++) {
+        if (strcmp(ctx->defs[j].name, token) == 0) {
+            def = &ctx->defs[j];
+            break;
+        }
+    }
+    if (!def) {
+        fprintf(stderr, "Errore in %s: Gate non definito (%s)\n", ctx->filename, token);
+        return EXIT_FAILURE;
+    }
+
+    // Seconda fase: la matrice viene letta al primo utilizzo del gate, poi tutti gli usi condividono la stessa copia
+    if (!def->storage) {
+        if (parse_gate_def(ctx->a, ctx->filename, def, ctx->dim)) return EXIT_FAILURE;
+        def->storage = gate_storage_new(def->matrix, 0);
+        if (!def->storage) {
+            perror("Allocazione memoria fallita");
+            free(def->matrix);
+            def->matrix = NULL;
+            return EXIT_FAILURE;
+        }
+    }
+
+    g->kind = GATE_MATRIX;
+    gate_share_matrix(g, def->storage, def->matrix);
+    g->name = strdup(def->name);
+    if (!g->name) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+// Risolve un token del circuito: gate singolo, sotto-circuito (#subcirc) ed eventuale ripetizione TOKEN^n
+// Un sotto-circuito usato una volta viene espanso nella lista, un token ripetuto diventa un GATE_BLOCK
+// (fuso in una sola matrice quando conviene, vedi block_should_fuse())
+static int resolve_token(resolve_ctx *ctx, const char *token, gate_list *list, int depth) {
+    if (depth > MAX_SUBCIRC_DEPTH) {
+        fprintf(stderr, "Errore in %s: Sotto-circuiti annidati troppo in profondita' (%s)\n", ctx->filename, token);
+        return EXIT_FAILURE;
+    }
+
+    // Token gia' fuso: si riusa la stessa matrice senza ricalcolare la potenza
+    for (int i = 0; i < ctx->fused->n; i++) {
+        fused_block *fb = &ctx->fused->blocks[i];
+        if (strcmp(fb->token, token) != 0) continue;
+        gate *g = gate_list_push(list);
+        if (!g) return EXIT_FAILURE;
+        g->kind = GATE_MATRIX;
+        gate_share_matrix(g, fb->storage, fb->matrix);
+        g->name = strdup(token);
+        if (!g->name) {
+            perror("Allocazione memoria fallita");
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Ripetizione: il '^' deve seguire l'eventuale parentesi chiusa
+    long reps = 1;
+    size_t base_len = strlen(token);
+    const char *caret = strrchr(token, '^');
+    if (caret && !strchr(caret, ')')) {
+        char *endptr = NULL;
+        errno = 0;
+        reps = strtol(caret + 1, &endptr, 10);
+        if (errno != 0 || endptr == caret + 1 || *endptr != '\0' || reps < 1 || reps > INT_MAX) {
+            fprintf(stderr, "Errore in %s: Ripetizione non valida (%s)\n", ctx->filename, token);
+            return EXIT_FAILURE;
+        }
+        base_len = caret - token;
+    }
+    char *base = arena_strndup(ctx->a, token, base_len);
+    if (!base) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    subcirc_def *sub = strchr(base, '(') ? NULL : find_subcirc(ctx, base);
+    if (!sub && reps == 1) return resolve_gate(ctx, base, list);
+
+    gate_list body = {NULL, 0, 0};
+    if (sub) {
+        for (int i = 0; i < sub->n_tokens; i++) {
+            if (resolve_token(ctx, sub->tokens[i], &body, depth + 1)) goto fail;
+        }
+    }
+    else if (resolve_gate(ctx, base, &body)) goto fail;
+
+    if (reps == 1) {
+        // Sotto-circuito senza ripetizione: i suoi gate vengono spostati nella lista
+        if (gate_list_reserve(list, body.n)) goto fail;
+        memcpy(list->gates + list->n, body.gates, body.n * sizeof(gate));
+        list->n += body.n;
+        free(body.gates);
+        return EXIT_SUCCESS;
+    }
+
+    gate *g = gate_list_push(list);
+    if (!g) goto fail;
+    g->kind = GATE_BLOCK;
+    g->sub = body.gates;
+    g->n_sub = body.n;
+    g->reps = (int)reps;
+    g->name = strdup(token);
+    if (!g->name) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    if (!block_should_fuse(g, ctx->dim)) return EXIT_SUCCESS;
+    if (block_fuse(g, ctx->dim)) return EXIT_FAILURE;
+
+    // La matrice fusa passa a una memoria condivisa, tenuta anche dalla lista dei blocchi fusi
+    fused_list *fl = ctx->fused;
+    if (fl->n == fl->cap) {
+        int new_cap = fl->cap ? fl->cap * 2 : 8;
+        fused_block *new_blocks = arena_grow(ctx->a, fl->blocks, fl->cap * sizeof(fused_block), new_cap * sizeof(fused_block));
+        if (!new_blocks) {
+            perror("Allocazione memoria fallita");
+            return EXIT_FAILURE;
+        }
+        fl->blocks = new_blocks;
+        fl->cap = new_cap;
+    }
+    gate_storage *storage = gate_storage_new(g->matrix, 0);
+    if (!storage) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+    fused_block *fb = &fl->blocks[fl->n++];
+    fb->token = token;
+    fb->storage = storage;
+    fb->matrix = g->matrix;
+    g->matrix = NULL;
+    gate_share_matrix(g, storage, fb->matrix);
+    return EXIT_SUCCESS;
+
+fail:
+    free_circuit(body.gates, body.n);
+    return EXIT_FAILURE;
+}
+
+// Sink di load_gates_circ(): accumula i gate nel circuito in uscita
+static int list_sink(gate *g, void *ctx) {
+    gate *slot = gate_list_push(ctx);
+    if (!slot) {
+        gate_release(g);
+        return EXIT_FAILURE;
+    }
+    *slot = *g;
     return EXIT_SUCCESS;
 }
 
-int load_gates_circ(const char *filename, int *n_gates_out, gate **circuit_out, const int n_qubits) {
-    FILE *fp = NULL;
+// Caricamento completo del file circuito: ogni gate risolto viene passato a sink, nell'ordine di #circ
+static int load_circ(const char *filename, const int n_qubits, param_table *params_out, gate_sink sink, void *sink_ctx) {
     int ret = EXIT_FAILURE;
-    char *line = NULL;
-    char *block = NULL;
-    char *mat_buf = NULL;
-    char *row_buf = NULL;
-    gate *circuit = NULL;
+    arena a; // Tutta la memoria temporanea del caricamento, liberata in una sola volta
+    char *buf = NULL;
+    size_t buf_len = 0;
+    gate_def *defs = NULL;
+    int n_defs = 0, cap_defs = 0;
+    subcirc_def *subs = NULL;
+    int n_subs = 0, cap_subs = 0;
     char *circ_in = NULL;
-    int n_gates = 0;
-    int idx_line = 1;
-    char *gate_name = NULL;
+    int n_circ = 0;
+    char **tokens = NULL;
+    gate_list pending = {NULL, 0, 0}; // Gate risolti da un token, non ancora passati a sink
+    fused_list fused = {NULL, 0, 0};
+    param_table params = {0, NULL, NULL};
     size_t dim = 1UL << n_qubits;
-    
-    fp = fopen(filename, "r");
-    if (!fp) {
+
+    arena_init(&a);
+    buf = arena_read_file(&a, filename, &buf_len);
+    if (!buf) {
         perror(filename);
         goto cleanup;
     }
 
-    while ((line = read_line(fp)) != NULL) {
+    // Prima fase: indicizza le definizioni dei gate (senza leggere le matrici), i parametri e il circuito
+    char *line = buf;
+    int idx_line = 1;
+    while (*line) {
+        char *line_end = strchr(line, '\n');
+        char *next_line = line_end ? line_end + 1 : buf + buf_len;
+
         if (strncmp(line, "#define ", 8) == 0) {
-            block = string_append(NULL, line);
-            if (!block) {
-                perror("Allocazione memoria fallita");
+            // Estrai il nome del gate
+            char *name_start = line + 8;
+            while (*name_start != '\n' && isspace((unsigned char)*name_start)) name_start++;
+            char *name_end = name_start;
+            while (*name_end && !isspace((unsigned char)*name_end)) name_end++;
+            int name_len = name_end - name_start;
+            if (name_len > 15) {
+                fprintf(stderr, "Errore in %s, riga %d: Nome gate troppo lungo\n", filename, idx_line);
+                goto cleanup;
+            }
+            // '^' nel circuito indica una ripetizione (TOKEN^n), non puo' far parte del nome
+            if (memchr(name_start, '^', name_len)) {
+                fprintf(stderr, "Errore in %s, riga %d: Il nome di un gate non puo' contenere '^'\n", filename, idx_line);
                 goto cleanup;
             }
 
-            // Trova le parentesi quadre (Anche su più righe!)
-            char *open_bracket = strchr(block, '[');
-            while (!open_bracket) {
-                char *next_line = read_line(fp);
-                if (!next_line) break;
-                idx_line++;
-                block = string_append(block, next_line);
-                free(next_line);
-                if (!block) {
-                    perror("Allocazione memoria fallita");
+            gate_def def;
+            memcpy(def.name, name_start, name_len);
+            def.name[name_len] = '\0';
+            def.line = idx_line;
+            def.matrix = NULL;
+            def.storage = NULL;
+            def.import = NULL;
+
+            // Controlla per duplicati nei gate
+            for (int i = 0; i < n_defs; i++) {
+                if (strcmp(defs[i].name, def.name) == 0) {
+                    fprintf(stderr, "Errore in %s, riga %d: Gate duplicato (%s)\n", filename, idx_line, def.name);
                     goto cleanup;
                 }
-                open_bracket = strchr(block, '[');
             }
 
+            // Trova le parentesi quadre (Anche su più righe!)
+            char *open_bracket = strchr(line, '[');
             if (!open_bracket) {
-                fprintf(stderr, "Errore in %s, riga %d: Parentesi quadre mancanti\n", filename, idx_line);
+                for (char *p = line; *p; p++) if (*p == '\n') idx_line++;
+                fprintf(stderr, "Errore in %s, riga %d: Parentesi quadre mancanti\n", filename, idx_line - 1);
                 goto cleanup;
             }
-
             char *close_bracket = strchr(open_bracket, ']');
-            while (!close_bracket) {
-                char *next_line = read_line(fp);
-                if (!next_line) break;
-                idx_line++;
-                block = string_append(block, next_line);
-                free(next_line);
-                if (!block) {
+            if (!close_bracket) {
+                for (char *p = line; *p; p++) if (*p == '\n') idx_line++;
+                fprintf(stderr, "Errore in %s, riga %d: Parentesi quadre non chiuse\n", filename, idx_line - 1);
+                goto cleanup;
+            }
+
+            // La matrice verra' letta solo se il gate e' usato nel circuito
+            *close_bracket = '\0';
+            def.mat_start = open_bracket + 1;
+            for (char *p = line; p < close_bracket; p++) if (*p == '\n') idx_line++;
+
+            if (n_defs == cap_defs) {
+                int new_cap = cap_defs ? cap_defs * 2 : 16;
+                gate_def *new_defs = arena_grow(&a, defs, cap_defs * sizeof(gate_def), new_cap * sizeof(gate_def));
+                if (!new_defs) {
                     perror("Allocazione memoria fallita");
                     goto cleanup;
                 }
-                open_bracket = strchr(block, '[');
-                close_bracket = strchr(open_bracket, ']');
+                defs = new_defs;
+                cap_defs = new_cap;
             }
+            defs[n_defs++] = def;
 
-            if (!close_bracket) {
-                fprintf(stderr, "Errore in %s, riga %d: Parentesi quadre non chiuse\n", filename, idx_line);
+            // Riprende dalla riga successiva a quella con ']'
+            line_end = strchr(close_bracket + 1, '\n');
+            next_line = line_end ? line_end + 1 : buf + buf_len;
+        }
+        else if (strncmp(line, "#import ", 8) == 0) {
+            if (line_end) *line_end = '\0';
+
+            // Nome del gate seguito dal file con la matrice (scritto con --unitary)
+            char *cursor = line + 8;
+            char *name = next_circ_token(&cursor);
+            trim_whitespace(cursor);
+            if (!name || strlen(name) > 15 || *cursor == '\0') {
+                fprintf(stderr, "Errore in %s, riga %d: #import richiede un nome (max 15 caratteri) e un file\n", filename, idx_line);
                 goto cleanup;
             }
+            if (strchr(name, '^')) {
+                fprintf(stderr, "Errore in %s, riga %d: Il nome di un gate non puo' contenere '^'\n", filename, idx_line);
+                goto cleanup;
+            }
+            for (int i = 0; i < n_defs; i++) {
+                if (strcmp(defs[i].name, name) == 0) {
+                    fprintf(stderr, "Errore in %s, riga %d: Gate duplicato (%s)\n", filename, idx_line, name);
+                    goto cleanup;
+                }
+            }
 
-            // Estrai il nome del gate
-            char *name_start = block + 8;
+            if (n_defs == cap_defs) {
+                int new_cap = cap_defs ? cap_defs * 2 : 16;
+                gate_def *new_defs = arena_grow(&a, defs, cap_defs * sizeof(gate_def), new_cap * sizeof(gate_def));
+                if (!new_defs) {
+                    perror("Allocazione memoria fallita");
+                    goto cleanup;
+                }
+                defs = new_defs;
+                cap_defs = new_cap;
+            }
+            gate_def *def = &defs[n_defs++];
+            strcpy(def->name, name);
+            def->mat_start = NULL;
+            def->line = idx_line;
+            def->matrix = NULL;
+            def->storage = NULL;
+            def->import = cursor;
+        }
+        else if (strncmp(line, "#param ", 7) == 0) {
+            if (line_end) *line_end = '\0';
+
+            // Estrai nome e valore di default del parametro
+            char *name_start = line + 7;
             while (isspace((unsigned char)*name_start)) name_start++;
             char *name_end = name_start;
             while (*name_end && !isspace((unsigned char)*name_end)) name_end++;
             int name_len = name_end - name_start;
-            if (name_len > 15) {
-                fprintf(stderr, "Errore in %s, riga %d: Nome gate troppo lungo\n", filename, idx_line);
+            if (name_len == 0 || name_len > 15) {
+                fprintf(stderr, "Errore in %s, riga %d: Nome parametro non valido\n", filename, idx_line);
                 goto cleanup;
             }
+            char *value_str = name_end;
+            if (*value_str) *value_str++ = '\0';
+            trim_whitespace(value_str);
 
-            gate_name = malloc(name_len + 1);
-            if (!gate_name) {
-                perror("Allocazione memoria fallita");
+            double value;
+            if (parse_real(value_str, &value)) {
+                fprintf(stderr, "Errore in %s, riga %d: Parsing valore del parametro fallito (%s)\n", filename, idx_line, value_str);
                 goto cleanup;
             }
-            strncpy(gate_name, name_start, name_len);
-            gate_name[name_len] = '\0';
-
-            // Controlla per duplicati nei gate
-            for (int i = 0; i < n_gates; i++) {
-                if (strcmp(circuit[i].name, gate_name) == 0) {
-                    fprintf(stderr, "Errore in %s, riga %d: Gate duplicato (%s)\n", filename, idx_line, gate_name);
-                    goto cleanup;
-                }
+            if (param_find(&params, name_start) >= 0) {
+                fprintf(stderr, "Errore in %s, riga %d: Parametro duplicato (%s)\n", filename, idx_line, name_start);
+                goto cleanup;
             }
-
-            // Estrai la stringa contenente la matrice
-            size_t len = close_bracket - open_bracket - 1;
-            mat_buf = malloc(len + 1);
-            if (!mat_buf) {
+            if (param_add(&params, name_start, value)) {
                 perror("Allocazione memoria fallita");
                 goto cleanup;
             }
-            strncpy(mat_buf, open_bracket + 1, len);
-            mat_buf[len] = '\0';
-            
-            // Libera subito block
-            free(block);
-            block = NULL;
+        }
+        else if (strncmp(line, "#subcirc ", 9) == 0) {
+            if (line_end) *line_end = '\0';
 
-            // Inizia il parsing della matrice
-            complex *t_mat = malloc(dim * dim * sizeof(complex));
-            if (!t_mat) {
-                perror("Allocazione memoria fallita");
+            // Nome del sotto-circuito seguito dai suoi gate, con la stessa sintassi di #circ
+            char *cursor = line + 9;
+            char *name = next_circ_token(&cursor);
+            if (!name || strlen(name) > 15 || strpbrk(name, "()^")) {
+                fprintf(stderr, "Errore in %s, riga %d: Nome sotto-circuito non valido\n", filename, idx_line);
                 goto cleanup;
             }
-
-            size_t mat_idx = 0;
-            char *p_mat_buf = mat_buf;
-            for (size_t row_idx = 0; row_idx < dim; row_idx++) {
-                char *row_lbr = strchr(p_mat_buf, '(');
-                char *row_rbr = strchr(p_mat_buf, ')');
-                if (!row_lbr || !row_rbr || row_rbr < row_lbr) {
-                    fprintf(stderr, "Errore in %s, riga %d: Parentesi tonde malformate\n", filename, idx_line);
-                    free(t_mat);
+            for (int i = 0; i < n_subs; i++) {
+                if (strcmp(subs[i].name, name) == 0) {
+                    fprintf(stderr, "Errore in %s, riga %d: Sotto-circuito duplicato (%s)\n", filename, idx_line, name);
                     goto cleanup;
                 }
+            }
 
-                size_t row_len = row_rbr - row_lbr - 1;
-                row_buf = malloc(row_len + 1);
-                if (!row_buf) {
+            if (n_subs == cap_subs) {
+                int new_cap = cap_subs ? cap_subs * 2 : 16;
+                subcirc_def *new_subs = arena_grow(&a, subs, cap_subs * sizeof(subcirc_def), new_cap * sizeof(subcirc_def));
+                if (!new_subs) {
                     perror("Allocazione memoria fallita");
-                    free(t_mat);
                     goto cleanup;
                 }
-                strncpy(row_buf, row_lbr + 1, row_len);
-                row_buf[row_len] = '\0';
-
-                char *tkn = strtok(row_buf, ",");
-                while (tkn) {
-                    trim_whitespace(tkn); // Il parser accetta solo input sanificato
-                    if (parse_complex(tkn, &t_mat[mat_idx])) {
-                        fprintf(stderr, "Errore in %s, riga %d: Parsing fallito (%s)\n", filename, idx_line, tkn);
-                        free(row_buf);
-                        free(t_mat);
-                        row_buf = NULL;
-                        goto cleanup;
-                    }
-                    mat_idx++;
-                    tkn = strtok(NULL, ",");
-                }
-                free(row_buf);
-                row_buf = NULL;
-                p_mat_buf = row_rbr + 1;
-            }
-            
-            // Libera subito il buffer della matrice
-            free(mat_buf);
-            mat_buf = NULL;
-
-            // Crea nuovo gate
-            gate t_gate;
-            t_gate.name = gate_name;
-            t_gate.matrix = t_mat;
-            gate_name = NULL;  // Trasferita la proprieta' a t_gate
-
-            // Aggiungi al circuito
-            gate *new_circuit = realloc(circuit, (n_gates + 1) * sizeof(gate));
-            if (!new_circuit) {
+                subs = new_subs;
+                cap_subs = new_cap;
+            }
+            subcirc_def *sub = &subs[n_subs];
+            strcpy(sub->name, name);
+            if (tokenize_circ(&a, cursor, &sub->tokens, &sub->n_tokens)) {
                 perror("Allocazione memoria fallita");
-                free(t_gate.name);
-                free(t_gate.matrix);
                 goto cleanup;
             }
-            circuit = new_circuit;
-            circuit[n_gates++] = t_gate;
-        }
-        else if (!circ_in && strncmp(line, "#circ ", 6) == 0) {
-            // Estrai stringa circuito
-            char *circ_start = line + 5;
-            while (isspace((unsigned char)*circ_start)) circ_start++;
-            circ_in = strdup(circ_start);
-            if (!circ_in) {
-                perror("Allocazione memoria fallita");
+            if (sub->n_tokens == 0) {
+                fprintf(stderr, "Errore in %s, riga %d: Sotto-circuito vuoto (%s)\n", filename, idx_line, name);
                 goto cleanup;
             }
+            n_subs++;
+        }
+        else if (!circ_in && strncmp(line, "#circ ", 6) == 0) {
+            // Il circuito viene tokenizzato dopo, quando tutti i gate sono indicizzati
+            if (line_end) *line_end = '\0';
+            circ_in = line + 5;
         }
-        free(line);
-        line = NULL;
+
         idx_line++;
+        line = next_line;
     }
 
     // Inizia validazione e costruzione del circuito finale
@@ -321,104 +890,184 @@ int load_gates_circ(const char *filename, int *n_gates_out, gate **circuit_out,
         goto cleanup;
     }
 
-    // Estrae i nomi dei gate (tokens) e costruisce il circuito
-    int n_circ = 0;
-    char **tokens = NULL;
-    gate *new_circuit = NULL;
-    char *saveptr;
-    char *token = strtok_r(circ_in, " ", &saveptr);
-    while (token) {
-        char **new_tokens = realloc(tokens, (n_circ + 1) * sizeof(char *));
-        if (!new_tokens) {
-            perror("Allocazione memoria fallita");
-            goto circuit_cleanup;
-        }
-        tokens = new_tokens;
-        tokens[n_circ] = strdup(token);
-        if (!tokens[n_circ]) {
-            perror("Allocazione memoria fallita");
-            goto circuit_cleanup;
+    // Un nome non puo' indicare sia un gate che un sotto-circuito
+    for (int i = 0; i < n_subs; i++) {
+        for (int j = 0; j < n_defs; j++) {
+            if (strcmp(subs[i].name, defs[j].name) == 0) {
+                fprintf(stderr, "Errore in %s: Nome usato sia da un gate che da un sotto-circuito (%s)\n", filename, subs[i].name);
+                goto cleanup;
+            }
         }
-        n_circ++;
-        token = strtok_r(NULL, " ", &saveptr);
     }
 
-    // Costruzione effettiva
-    new_circuit = malloc(n_circ * sizeof(gate));
-    if (!new_circuit) {
+    // Estrae i nomi dei gate (tokens), terminati in-place nel buffer del file
+    if (tokenize_circ(&a, circ_in, &tokens, &n_circ)) {
         perror("Allocazione memoria fallita");
-        goto circuit_cleanup;
+        goto cleanup;
     }
-    memset(new_circuit, 0, n_circ * sizeof(gate)); // Inizializzo a 0
 
-    size_t mat_size = dim * dim * sizeof(complex);
+    // Costruzione effettiva
+    resolve_ctx ctx = {&a, filename, defs, n_defs, subs, n_subs, &params, n_qubits, dim, &fused};
     for (int i = 0; i < n_circ; i++) {
-        int found = 0;
-        for (int j = 0; j < n_gates; j++) {
-            if (strcmp(circuit[j].name, tokens[i]) == 0) {
-                // Duplica gate name
-                new_circuit[i].name = strdup(circuit[j].name);
-                if (!new_circuit[i].name) {
-                    perror("Allocazione memoria fallita");
-                    goto circuit_cleanup;
-                }
+        if (resolve_token(&ctx, tokens[i], &pending, 0)) goto cleanup;
 
-                // Duplica matrice
-                new_circuit[i].matrix = malloc(mat_size);
-                if (!new_circuit[i].matrix) {
-                    perror("Allocazione memoria fallita");
-                    free(new_circuit[i].name);
-                    new_circuit[i].name = NULL;
-                    goto circuit_cleanup;
-                }
-                memcpy(new_circuit[i].matrix, circuit[j].matrix, mat_size);
-                found = 1;
-                break;
-            }
-        }
-
-        if (!found) {
-            fprintf(stderr, "Errore in %s: Gate non definito (%s)\n", filename, tokens[i]);
-            goto circuit_cleanup;
+        // Ogni gate passa a sink appena risolto: lo slot viene azzerato perche' la proprieta' e' di sink
+        for (int j = 0; j < pending.n; j++) {
+            gate g = pending.gates[j];
+            memset(&pending.gates[j], 0, sizeof(gate));
+            if (sink(&g, sink_ctx)) goto cleanup;
         }
+        pending.n = 0;
     }
 
     // In caso di successo trasferisco la proprieta'
-    *n_gates_out = n_circ;
-    *circuit_out = new_circuit;
+    if (params_out) {
+        *params_out = params;
+        params = (param_table){0, NULL, NULL};
+    }
     ret = EXIT_SUCCESS;
 
-// Pulizia specifica della parte sulla costruzione dei circuiti
-circuit_cleanup:
-    if (tokens) {
-        for (int i = 0; i < n_circ; i++) free(tokens[i]);
-        free(tokens);
+cleanup:
+    free_circuit(pending.gates, pending.n);
+    free_params(&params);
+    // Le matrici restano finche' le usa qualche gate
+    for (int i = 0; i < n_defs; i++) gate_storage_release(defs[i].storage);
+    for (int i = 0; i < fused.n; i++) gate_storage_release(fused.blocks[i].storage);
+    arena_free(&a);
+    return ret;
+}
+
+int load_gates_circ(const char *filename, int *n_gates_out, gate **circuit_out, param_table *params_out, const int n_qubits) {
+    gate_list out = {NULL, 0, 0};
+    if (load_circ(filename, n_qubits, params_out, list_sink, &out)) {
+        free_circuit(out.gates, out.n);
+        return EXIT_FAILURE;
     }
-    if (ret != EXIT_SUCCESS && new_circuit) {
-        for (int i = 0; i < n_circ; i++) {
-            if (new_circuit[i].name) free(new_circuit[i].name);
-            if (new_circuit[i].matrix) free(new_circuit[i].matrix);
-        }
-        free(new_circuit);
+    *n_gates_out = out.n;
+    *circuit_out = out.gates;
+    return EXIT_SUCCESS;
+}
+
+int load_gates_stream(const char *filename, const int n_qubits, gate_sink sink, void *ctx) {
+    return load_circ(filename, n_qubits, NULL, sink, ctx);
+}
+
+int load_sweep(const char *filename, const param_table *params, int *n_points_out, double **points_out) {
+    int ret = EXIT_FAILURE;
+    arena a;
+    int *columns = NULL; // Indice del parametro associato a ogni colonna di #point
+    int n_columns = 0, cap_columns = 0;
+    double *points = NULL;
+    int n_points = 0, cap_points = 0;
+    int idx_line = 1;
+    int n_params = params ? params->n_params : 0;
+
+    arena_init(&a);
+    char *cursor = arena_read_file(&a, filename, NULL);
+    if (!cursor) {
+        perror(filename);
+        goto cleanup;
     }
 
-// Pulizia principale
-cleanup:
-    if (fp) fclose(fp);
-    if (line) free(line);
-    if (block) free(block);
-    if (mat_buf) free(mat_buf);
-    if (row_buf) free(row_buf);
-    if (circ_in) free(circ_in);
-    if (gate_name) free(gate_name);
-    
-    // Libera il circuito originale (Tutto ciò che serviva è stato duplicato)
-    if (circuit) {
-        for (int i = 0; i < n_gates; i++) {
-            if (circuit[i].name) free(circuit[i].name);
-            if (circuit[i].matrix) free(circuit[i].matrix);
+    char *line;
+    while ((line = next_line(&cursor)) != NULL) {
+        if (!columns && strncmp(line, "#sweep", 6) == 0 && (line[6] == '\0' || isspace((unsigned char)line[6]))) {
+            char *saveptr;
+            char *tkn = strtok_r(line + 6, ",", &saveptr);
+            while (tkn) {
+                trim_whitespace(tkn);
+                if (*tkn == '\0') {
+                    tkn = strtok_r(NULL, ",", &saveptr);
+                    continue;
+                }
+                int param = param_find(params, tkn);
+                if (param < 0) {
+                    fprintf(stderr, "Errore in %s, riga %d: Parametro non definito nel circuito (%s)\n", filename, idx_line, tkn);
+                    goto cleanup;
+                }
+                for (int i = 0; i < n_columns; i++) {
+                    if (columns[i] == param) {
+                        fprintf(stderr, "Errore in %s, riga %d: Parametro ripetuto in #sweep (%s)\n", filename, idx_line, tkn);
+                        goto cleanup;
+                    }
+                }
+                if (n_columns == cap_columns) {
+                    int new_cap = cap_columns ? cap_columns * 2 : 16;
+                    int *new_columns = arena_grow(&a, columns, cap_columns * sizeof(int), new_cap * sizeof(int));
+                    if (!new_columns) {
+                        perror("Allocazione memoria fallita");
+                        goto cleanup;
+                    }
+                    columns = new_columns;
+                    cap_columns = new_cap;
+                }
+                columns[n_columns++] = param;
+                tkn = strtok_r(NULL, ",", &saveptr);
+            }
+            if (n_columns == 0) {
+                fprintf(stderr, "Errore in %s, riga %d: #sweep senza parametri\n", filename, idx_line);
+                goto cleanup;
+            }
+        }
+        else if (strncmp(line, "#point ", 7) == 0) {
+            if (!columns) {
+                fprintf(stderr, "Errore in %s, riga %d: #point prima di #sweep\n", filename, idx_line);
+                goto cleanup;
+            }
+
+            // Array di uscita (sopravvive al caricamento): cresce raddoppiando
+            if (n_points == cap_points) {
+                int new_cap = cap_points ? cap_points * 2 : 64;
+                double *new_points = realloc(points, (size_t)new_cap * n_params * sizeof(double));
+                if (!new_points) {
+                    perror("Allocazione memoria fallita");
+                    goto cleanup;
+                }
+                points = new_points;
+                cap_points = new_cap;
+            }
+
+            // I parametri non elencati in #sweep mantengono il valore di default
+            double *point = points + (size_t)n_points * n_params;
+            memcpy(point, params->values, n_params * sizeof(double));
+
+            int idx = 0;
+            char *saveptr;
+            char *tkn = strtok_r(line + 7, ",", &saveptr);
+            while (tkn) {
+                trim_whitespace(tkn);
+                if (idx == n_columns) {
+                    fprintf(stderr, "Errore in %s, riga %d: Elementi di #point superiori al necessario\n", filename, idx_line);
+                    goto cleanup;
+                }
+                if (parse_real(tkn, &point[columns[idx]])) {
+                    fprintf(stderr, "Errore in %s, riga %d: Parsing numero fallito (%s)\n", filename, idx_line, tkn);
+                    goto cleanup;
+                }
+                idx++;
+                tkn = strtok_r(NULL, ",", &saveptr);
+            }
+            if (idx < n_columns) {
+                fprintf(stderr, "Errore in %s, riga %d: Elementi di #point inferiori al necessario\n", filename, idx_line);
+                goto cleanup;
+            }
+            n_points++;
         }
-        free(circuit);
+        idx_line++;
+    }
+
+    if (n_points == 0) {
+        fprintf(stderr, "Errore in %s: Nessun #point presente\n", filename);
+        goto cleanup;
     }
+
+    *n_points_out = n_points;
+    *points_out = points;
+    points = NULL;
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    if (points) free(points);
+    arena_free(&a);
     return ret;
-}
\ No newline at end of file
+}
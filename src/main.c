@@ -1,63 +1,285 @@
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "arena.h"
+#include "cache.h"
+#include "checkpoint.h"
 #include "complex.h"
 #include "gate.h"
+#include "param.h"
 #include "parser.h"
 #include "loader.h"
+#include "statevec.h"
+#include "stream.h"
+#include "sweep.h"
+#include "unitary.h"
 #include "utils.h"
 
+// Legge la lista di indici di --checkpoint ("3,10,25"): numero di gate dopo cui salvare lo stato
+static int parse_checkpoints(const char *list, int **out, int *n_out) {
+    int n = 1;
+    for (const char *p = list; *p; p++) if (*p == ',') n++;
+    int *idx = malloc(n * sizeof(int));
+    if (!idx) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    const char *p = list;
+    for (int i = 0; i < n; i++) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 1 || v > 0x7fffffff || (*end != ',' && *end != '\0')) {
+            fprintf(stderr, "Errore: Indice di --checkpoint non valido (%s)\n", list);
+            free(idx);
+            return EXIT_FAILURE;
+        }
+        idx[i] = (int)v;
+        p = end + 1;
+    }
+    *out = idx;
+    *n_out = n;
+    return EXIT_SUCCESS;
+}
+
+static int compare_int(const void *a, const void *b) {
+    int ia = *(const int *)a, ib = *(const int *)b;
+    return (ia > ib) - (ia < ib);
+}
+
+// Stampa su stderr tempo e allocazioni dell'arena durante il caricamento di un file
+// (le matrici e i nomi dei gate allocati con malloc non sono contati)
+static void print_load_stats(const char *filename, double start_ms, const arena_stats *before) {
+    arena_stats after;
+    arena_get_stats(&after);
+    fprintf(stderr, "Caricamento %s: %.3f ms, solo arena: %zu allocazioni in %zu blocchi (%zu byte), "
+            "matrici e nomi dei gate esclusi\n",
+            filename, now_ms() - start_ms, after.n_allocs - before->n_allocs,
+            after.n_blocks - before->n_blocks, after.bytes - before->bytes);
+}
+
 int main(int argc, char *argv[]) {
 
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <init_file> <circuit_file>\n", argv[0]);
+    // Opzioni (--...) e file posizionali
+    int use_cache = 1, mem_report = 0, stats = 0, stream = 0;
+    char *unitary_file = NULL;
+    char *checkpoint_list = NULL;
+    char *files[3] = {NULL, NULL, NULL};
+    int n_files = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--no-cache") == 0) use_cache = 0;
+        else if (strcmp(argv[i], "--mem-report") == 0) mem_report = 1;
+        else if (strcmp(argv[i], "--stats") == 0) stats = 1;
+        else if (strcmp(argv[i], "--stream") == 0) stream = 1;
+        else if (strcmp(argv[i], "--unitary") == 0 && i + 1 < argc) unitary_file = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint") == 0 && i + 1 < argc) checkpoint_list = argv[++i];
+        else if (strncmp(argv[i], "--", 2) == 0 || n_files == 3) n_files = -1;
+        else files[n_files++] = argv[i];
+        if (n_files < 0) break;
+    }
+
+    // --unitary, --checkpoint e --stream sono modalita' alternative tra loro e allo sweep
+    int n_modes = (unitary_file != NULL) + (checkpoint_list != NULL) + stream;
+    if (n_files < 2 || n_modes > 1 || (n_modes && n_files > 2)) {
+        fprintf(stderr, "Usage: %s [--no-cache] [--mem-report] [--stats] [--unitary <out_file> | --checkpoint <i,j,...> | --stream] "
+                        "<init_file> <circuit_file> [sweep_file]\n", argv[0]);
         return EXIT_FAILURE;
     }
 
-    char *init_file = argv[1], *circ_file = argv[2];
+    int *checkpoints = NULL;
+    int n_checkpoints = 0;
+    if (checkpoint_list && parse_checkpoints(checkpoint_list, &checkpoints, &n_checkpoints)) return EXIT_FAILURE;
+
+    char *init_file = files[0], *circ_file = files[1];
+    char *sweep_file = files[2];
 
     // Carica qubits e vec
     int n_qubits;
     complex *vec;
+    arena_stats stats_before;
+    arena_get_stats(&stats_before);
+    double start_ms = now_ms();
 
     if (load_qubits_init(init_file, &n_qubits, &vec)) {
         fprintf(stderr, "Errore caricando il file %s\n", init_file);
+        free(checkpoints);
         return EXIT_FAILURE;
     }
+    if (stats) print_load_stats(init_file, start_ms, &stats_before);
 
-    // Carica numero di gate e circuit
+    // Streaming: il circuito non viene caricato per intero (e non passa dalla cache),
+    // ogni gate viene applicato appena risolto e liberato subito dopo
+    if (stream) {
+        size_t dim = 1UL << n_qubits;
+        complex *t_vec = statevec_alloc(dim);
+        stream_stats st;
+        int ret = EXIT_FAILURE;
+        if (!t_vec) {
+            perror("Allocazione memoria fallita");
+        }
+        else {
+            if (mem_report) statevec_report(vec, dim, stderr);
+            start_ms = now_ms();
+            if (run_stream(circ_file, n_qubits, vec, t_vec, &st)) {
+                fprintf(stderr, "Errore caricando il file %s\n", circ_file);
+            }
+            else {
+                if (stats) fprintf(stderr, "Streaming %s: %d gate in %.3f ms, primo gate dopo %.3f ms, massimo %zu byte di matrici in coda\n",
+                                   circ_file, st.n_gates, now_ms() - start_ms, st.first_gate_ms, st.peak_bytes);
+                complex_vec_print(vec, dim);
+                fflush(stdout);
+                ret = EXIT_SUCCESS;
+            }
+        }
+        statevec_free(t_vec);
+        statevec_free(vec);
+        return ret;
+    }
+
+    // Carica numero di gate, circuit e parametri
     int n_gates;
     gate *circuit;
+    param_table params;
 
-    if(load_gates_circ(circ_file, &n_gates, &circuit, n_qubits)) {
-        fprintf(stderr, "Errore caricando il file %s\n", circ_file);
-        free(vec);
-        return EXIT_FAILURE;
+    arena_get_stats(&stats_before);
+    start_ms = now_ms();
+
+    // Cache e checkpoint sono associati al percorso del circuito e lo rileggono:
+    // un circuito da pipe o FIFO si puo' leggere una volta sola
+    struct stat circ_st;
+    if (stat(circ_file, &circ_st) == 0 && !S_ISREG(circ_st.st_mode)) {
+        if (n_checkpoints > 0)
+            fprintf(stderr, "Attenzione: checkpoint ignorati, %s non e' un file regolare\n", circ_file);
+        use_cache = 0;
+        n_checkpoints = 0;
+    }
+
+    // Prima prova la cache del circuito compilato, altrimenti parsing completo e salvataggio in cache
+    if (!use_cache || cache_load(circ_file, n_qubits, &n_gates, &circuit, &params)) {
+        if(load_gates_circ(circ_file, &n_gates, &circuit, &params, n_qubits)) {
+            fprintf(stderr, "Errore caricando il file %s\n", circ_file);
+            free(checkpoints);
+            statevec_free(vec);
+            return EXIT_FAILURE;
+        }
+        if (use_cache) cache_store(circ_file, n_qubits, circuit, n_gates, &params);
     }
+    if (stats) print_load_stats(circ_file, start_ms, &stats_before);
 
     size_t dim = 1UL << n_qubits;
-    complex *t_vec = malloc(dim * sizeof(complex)); // Array temp di supporto per la moltiplicazione
-    if (!t_vec) {
+
+    // Matrice unitaria dell'intero circuito (con i valori di default dei parametri), salvata su file
+    if (unitary_file) {
+        complex *U = NULL;
+        int ret = EXIT_FAILURE;
+        if (n_qubits > UNITARY_MAX_QUBITS) {
+            fprintf(stderr, "Errore: --unitary supporta al massimo %d qubits\n", UNITARY_MAX_QUBITS);
+        }
+        else if (!(U = malloc(dim * dim * sizeof(complex)))) {
+            perror("Allocazione memoria fallita");
+        }
+        else if (!circuit_unitary(circuit, n_gates, dim, U) && !unitary_write(unitary_file, U, n_qubits)) {
+            ret = EXIT_SUCCESS;
+        }
+
+        free(U);
+        free_params(&params);
+        free_circuit(circuit, n_gates);
+        statevec_free(vec);
+        return ret;
+    }
+
+    // Sweep: il circuito e' gia' stato caricato una volta, per ogni punto si rigenerano solo i gate parametrici
+    if (sweep_file) {
+        int n_points;
+        double *points;
+        if (load_sweep(sweep_file, &params, &n_points, &points)) {
+            fprintf(stderr, "Errore caricando il file %s\n", sweep_file);
+            free_params(&params);
+            free_circuit(circuit, n_gates);
+            statevec_free(vec);
+            return EXIT_FAILURE;
+        }
+
+        // Stampa in stdout dello stato finale di ogni punto, nell'ordine del file
+        if (run_sweep(circuit, n_gates, points, params.n_params, n_points, vec, n_qubits)) {
+            free(points);
+            free_params(&params);
+            free_circuit(circuit, n_gates);
+            statevec_free(vec);
+            return EXIT_FAILURE;
+        }
+
+        free(points);
+        free_params(&params);
+        free_circuit(circuit, n_gates);
+        statevec_free(vec);
+        fflush(stdout);
+        return EXIT_SUCCESS;
+    }
+
+    complex *t_vec = statevec_alloc(dim); // Array temp di supporto per la moltiplicazione
+    checkpoint_key *keys = NULL;
+    int use_checkpoints = n_checkpoints > 0 || (use_cache && checkpoint_exists(circ_file));
+    if (use_checkpoints) keys = malloc((n_gates + 1) * sizeof(checkpoint_key));
+    if (!t_vec || (use_checkpoints && !keys)) {
         perror("Allocazione memoria fallita");
+        free(keys);
+        free(checkpoints);
+        statevec_free(t_vec);
+        free_params(&params);
         free_circuit(circuit, n_gates);
-        free(vec);
+        statevec_free(vec);
         return EXIT_FAILURE;
     }
 
-    // Moltiplico secondo l'ordine dato in input
-    for (int i = 0; i < n_gates; i++) {
-        matvec_mul(circuit[i].matrix, vec, t_vec, dim);
+    if (mem_report) statevec_report(vec, dim, stderr);
+
+    // Checkpoint: si riparte dal prefisso piu' lungo gia' simulato (letto in t_vec, poi scambiato con vec)
+    int done = 0;
+    if (use_checkpoints) {
+        if (checkpoint_keys(vec, n_qubits, circuit, n_gates, keys)) {
+            perror("Allocazione memoria fallita");
+            free(keys);
+            free(checkpoints);
+            statevec_free(t_vec);
+            free_params(&params);
+            free_circuit(circuit, n_gates);
+            statevec_free(vec);
+            return EXIT_FAILURE;
+        }
+        if (use_cache) done = checkpoint_restore(circ_file, keys, n_gates, n_qubits, t_vec);
+        if (done > 0) {
+            complex *swap = vec; vec = t_vec; t_vec = swap;
+        }
+        if (stats) fprintf(stderr, "Checkpoint: %d gate su %d ripristinati\n", done, n_gates);
+    }
 
-        for (size_t j = 0; j < dim; j++)
-            vec[j] = t_vec[j];
+    // Moltiplico secondo l'ordine dato in input, fermandomi a ogni checkpoint richiesto per salvare lo stato
+    if (n_checkpoints > 0) qsort(checkpoints, n_checkpoints, sizeof(int), compare_int);
+    for (int i = 0; i < n_checkpoints; i++) {
+        if (checkpoints[i] > n_gates) {
+            fprintf(stderr, "Attenzione: checkpoint %d ignorato, il circuito ha %d gate\n", checkpoints[i], n_gates);
+            continue;
+        }
+        if (checkpoints[i] < done) continue;
+        apply_circuit(circuit + done, checkpoints[i] - done, vec, t_vec, dim);
+        done = checkpoints[i];
+        checkpoint_save(circ_file, &keys[done], done, n_qubits, vec);
     }
+    apply_circuit(circuit + done, n_gates - done, vec, t_vec, dim);
 
     // Stampa in stdout dello stato finale
     complex_vec_print(vec, dim);
 
-    free(t_vec);
+    free(keys);
+    free(checkpoints);
+    statevec_free(t_vec);
+    free_params(&params);
     free_circuit(circuit, n_gates);
-    free(vec);
+    statevec_free(vec);
     fflush(stdout);
 
     return EXIT_SUCCESS;
-}
\ No newline at end of file
+}
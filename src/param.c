@@ -0,0 +1,37 @@
+#include <stdlib.h>
+#include <string.h>
+#include "param.h"
+
+int param_find(const param_table *params, const char *name) {
+    if (!params) return -1;
+    for (int i = 0; i < params->n_params; i++) {
+        if (strcmp(params->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+int param_add(param_table *params, const char *name, double value) {
+    char **new_names = realloc(params->names, (params->n_params + 1) * sizeof(char *));
+    if (!new_names) return EXIT_FAILURE;
+    params->names = new_names;
+
+    double *new_values = realloc(params->values, (params->n_params + 1) * sizeof(double));
+    if (!new_values) return EXIT_FAILURE;
+    params->values = new_values;
+
+    params->names[params->n_params] = strdup(name);
+    if (!params->names[params->n_params]) return EXIT_FAILURE;
+    params->values[params->n_params] = value;
+    params->n_params++;
+    return EXIT_SUCCESS;
+}
+
+void free_params(param_table *params) {
+    if (!params) return;
+    for (int i = 0; i < params->n_params; i++) free(params->names[i]);
+    free(params->names);
+    free(params->values);
+    params->names = NULL;
+    params->values = NULL;
+    params->n_params = 0;
+}
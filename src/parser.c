@@ -93,39 +93,20 @@ int parse_complex(const char *str, complex *out) {
     // Non e' stato trovato l'indice del separatore, e' un numero immaginario
     if (split_index == 0)
         return parse_imag(str, out);
-    // Trovato l'indice del separatore, quindi si procede a separare la stringa in re e im.
+    // Trovato l'indice del separatore: la parte reale deve terminare esattamente sul separatore,
+    // la parte immaginaria e' il suffisso (gia' terminato), quindi non serve copiare la stringa.
     else {
-        // Separazione parte reale
-        int re_len = split_index;
-        char *re_str = malloc(re_len + 1);
-        if (!re_str) {
+        errno = 0;
+        char *end_ptr;
+        double temp_re = strtod(str, &end_ptr);
+        if (end_ptr == str || end_ptr != str + split_index || errno != 0) {
             return EXIT_FAILURE;
         }
 
-        strncpy(re_str, str, re_len);
-        re_str[re_len] = '\0';
-        
-        // Parte reale al parser
-        double temp_re;
-        if (parse_real(re_str, &temp_re)) {
-            free(re_str);
-            return EXIT_FAILURE;
-        }
-        free(re_str);
-
-        // Separazione parte immaginaria
-        int im_len = len - split_index;
-        char *im_str = malloc(im_len + 1);
-
-        strncpy(im_str, str + split_index, im_len);
-        im_str[im_len] = '\0';
-
         // Parte immaginaria al parser
-        if (parse_imag(im_str, out)) {
-            free(im_str);
+        if (parse_imag(str + split_index, out)) {
             return EXIT_FAILURE;
         }
-        free(im_str);
 
         out->re = temp_re;
     }
@@ -0,0 +1,205 @@
+#define _GNU_SOURCE // pthread_setaffinity_np, sched_getaffinity
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include "pool.h"
+
+#define POOL_MAX_WORKERS 256
+
+// Pool persistente: i worker vengono creati alla prima chiamata e restano fermi in attesa di lavoro.
+// Il worker 0 e' il thread chiamante, il worker w (w > 0) e' sempre lo stesso thread: cosi' la ripartizione
+// statica di pool_static() tocca sempre la stessa memoria. Con QCS_PIN=1 ogni worker viene anche fissato
+// sulla propria CPU; di default no, perche' piu' processi avviati insieme finirebbero tutti sulle prime CPU.
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t start;
+    pthread_cond_t done;
+    int size;
+    int started;            // Worker creati (escluso il chiamante)
+    int active;             // Un lavoro e' in corso (le chiamate annidate vengono eseguite in modo seriale)
+    unsigned long job_id;   // Incrementato ad ogni nuovo lavoro
+    int pending;            // Worker che non hanno ancora terminato il lavoro corrente
+
+    // Lavoro corrente
+    int is_static;
+    size_t next;
+    size_t n;
+    int failed;
+    pool_task task;
+    void *ctx;
+} pool = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0, 0, 0, 0, 0, 0, 0, NULL, NULL};
+
+static int cpus[POOL_MAX_WORKERS];
+static int n_cpus = 0;  // Resta 0 (nessun pinning) se QCS_PIN non e' attivo
+
+int pool_size(void) {
+    if (pool.size) return pool.size;
+
+    const char *env = getenv("QCS_THREADS");
+    long n = env ? strtol(env, NULL, 10) : 0;
+    if (n < 1) n = sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) n = 1;
+    if (n > POOL_MAX_WORKERS) n = POOL_MAX_WORKERS;
+    pool.size = (int)n;
+    return pool.size;
+}
+
+void pool_range(size_t n, int worker, size_t align, size_t *begin, size_t *end) {
+    size_t n_workers = pool_size();
+    if (align == 0) align = 1;
+    size_t chunk = (n + n_workers * align - 1) / (n_workers * align) * align;
+    size_t b = chunk * worker, e = b + chunk;
+    if (b > n) b = n;
+    if (e > n) e = n;
+    *begin = b;
+    *end = e;
+}
+
+// Fissa il thread chiamante sulla CPU assegnata al worker (se il sistema lo permette)
+static void pin_worker(int worker) {
+    if (n_cpus < 2) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpus[worker % n_cpus], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+void pool_unpin(void) {
+    if (n_cpus < 2) return;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i = 0; i < n_cpus; i++) CPU_SET(cpus[i], &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+// Esegue la parte del lavoro corrente che spetta al worker
+static void run_job(int worker) {
+    if (pool.is_static) {
+        if (worker < (int)pool.n && pool.task(worker, worker, pool.ctx)) {
+            pthread_mutex_lock(&pool.lock);
+            pool.failed = 1;
+            pthread_mutex_unlock(&pool.lock);
+        }
+        return;
+    }
+
+    // Distribuzione dinamica: preleva indici finche' ce ne sono (o finche' un task non fallisce)
+    while (1) {
+        pthread_mutex_lock(&pool.lock);
+        if (pool.failed || pool.next >= pool.n) {
+            pthread_mutex_unlock(&pool.lock);
+            break;
+        }
+        size_t idx = pool.next++;
+        pthread_mutex_unlock(&pool.lock);
+
+        if (pool.task(idx, worker, pool.ctx)) {
+            pthread_mutex_lock(&pool.lock);
+            pool.failed = 1;
+            pthread_mutex_unlock(&pool.lock);
+        }
+    }
+}
+
+static void *pool_loop(void *arg) {
+    int worker = (int)(size_t)arg;
+    unsigned long seen = 0;
+    pin_worker(worker);
+
+    pthread_mutex_lock(&pool.lock);
+    while (1) {
+        while (pool.job_id == seen) pthread_cond_wait(&pool.start, &pool.lock);
+        seen = pool.job_id;
+        pthread_mutex_unlock(&pool.lock);
+
+        run_job(worker);
+
+        pthread_mutex_lock(&pool.lock);
+        if (--pool.pending == 0) pthread_cond_signal(&pool.done);
+    }
+    return NULL;
+}
+
+// Crea i worker alla prima chiamata
+static void pool_init(void) {
+    if (pool.started || pool_size() == 1) return;
+
+    const char *pin = getenv("QCS_PIN");
+    cpu_set_t set;
+    if (pin && strtol(pin, NULL, 10) > 0 && sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int c = 0; c < CPU_SETSIZE && n_cpus < POOL_MAX_WORKERS; c++) {
+            if (CPU_ISSET(c, &set)) cpus[n_cpus++] = c;
+        }
+    }
+    pin_worker(0);
+
+    for (int i = 1; i < pool.size; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, pool_loop, (void *)(size_t)i) != 0) break;
+        pthread_detach(thread);
+        pool.started = i;
+    }
+}
+
+// Esegue un lavoro su tutti i worker e attende che sia terminato
+static int pool_dispatch(int is_static, size_t n, pool_task task, void *ctx) {
+    pthread_mutex_lock(&pool.lock);
+    if (pool.active) {
+        // Chiamata annidata (da dentro un task) o pool occupato da un altro thread: esecuzione seriale nel thread corrente
+        pthread_mutex_unlock(&pool.lock);
+        if (is_static) {
+            for (size_t w = 0; w < n; w++) {
+                if (task(w, (int)w, ctx)) return EXIT_FAILURE;
+            }
+            return EXIT_SUCCESS;
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (task(i, 0, ctx)) return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+    pool.active = 1; // Riservato subito: un altro thread che chiama ora esegue in modo seriale
+    pthread_mutex_unlock(&pool.lock);
+
+    pool_init();
+
+    pthread_mutex_lock(&pool.lock);
+    pool.is_static = is_static;
+    pool.next = 0;
+    pool.n = n;
+    pool.failed = 0;
+    pool.task = task;
+    pool.ctx = ctx;
+    pool.pending = pool.started;
+    pool.job_id++;
+    pthread_cond_broadcast(&pool.start);
+    pthread_mutex_unlock(&pool.lock);
+
+    run_job(0);
+
+    // Worker non creati (pthread_create fallito): la loro parte statica la esegue il chiamante
+    int failed = 0;
+    if (is_static) {
+        for (int w = pool.started + 1; w < (int)n; w++) {
+            if (task(w, w, ctx)) failed = 1;
+        }
+    }
+
+    pthread_mutex_lock(&pool.lock);
+    while (pool.pending > 0) pthread_cond_wait(&pool.done, &pool.lock);
+    pool.active = 0;
+    failed |= pool.failed;
+    pthread_mutex_unlock(&pool.lock);
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+int pool_for(size_t n, pool_task task, void *ctx) {
+    if (n == 0) return EXIT_SUCCESS;
+    return pool_dispatch(0, n, task, ctx);
+}
+
+int pool_static(pool_task task, void *ctx) {
+    return pool_dispatch(1, pool_size(), task, ctx);
+}
@@ -0,0 +1,239 @@
+#define _GNU_SOURCE // MAP_ANONYMOUS, MAP_HUGETLB, madvise, syscall
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include "statevec.h"
+#include "pool.h"
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+#define HUGE_1GB (1UL << 30)
+#define HUGE_2MB (1UL << 21)
+
+// Tipo di pagine ottenute per un vettore
+typedef enum {
+    PAGES_HUGETLB_1GB,
+    PAGES_HUGETLB_2MB,
+    PAGES_THP,      // Pagine normali con madvise(MADV_HUGEPAGE): il kernel le promuove a 2 MB solo se puo'
+    PAGES_NORMAL
+} page_kind;
+
+// Registro delle allocazioni attive (servono dimensione e tipo per munmap e per il report,
+// la dimensione delle pagine per ripartire il vettore tra i worker)
+#define MAX_STATEVECS 16
+static struct {
+    void *ptr;
+    size_t size;
+    size_t page;    // Byte di una pagina ottenuta (4 KB, 2 MB o 1 GB)
+    page_kind kind;
+} allocs[MAX_STATEVECS];
+
+static size_t round_up(size_t n, size_t align) {
+    return (n + align - 1) / align * align;
+}
+
+// Prova un mmap anonimo con le pagine richieste, NULL se non disponibili
+static void *try_map(size_t size, int extra_flags) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+typedef struct {
+    complex *vec;
+    size_t dim;
+    size_t align;
+} touch_ctx;
+
+// First touch: ogni worker azzera la propria porzione, fatta di pagine intere
+// (una huge page toccata da piu' worker finirebbe tutta sul nodo del primo)
+static int touch_task(size_t idx, int worker, void *arg) {
+    (void)idx;
+    touch_ctx *ctx = arg;
+    size_t begin, end;
+    pool_range(ctx->dim, worker, ctx->align, &begin, &end);
+    if (begin < end) memset(ctx->vec + begin, 0, (end - begin) * sizeof(complex));
+    return EXIT_SUCCESS;
+}
+
+complex *statevec_alloc(size_t dim) {
+    size_t bytes = dim * sizeof(complex);
+    size_t page = sysconf(_SC_PAGESIZE);
+    void *p = NULL;
+    size_t size = 0;
+    size_t page_size = page;
+    page_kind kind = PAGES_NORMAL;
+
+    int slot = 0;
+    while (slot < MAX_STATEVECS && allocs[slot].ptr) slot++;
+    if (slot == MAX_STATEVECS) return NULL;
+
+#ifdef MAP_HUGETLB
+    // Pagine hugetlbfs riservate: prima 1 GB, poi 2 MB (solo se il vettore ne riempie almeno una)
+    if (bytes >= HUGE_1GB) {
+        size = round_up(bytes, HUGE_1GB);
+        p = try_map(size, MAP_HUGETLB | (30 << MAP_HUGE_SHIFT));
+        kind = PAGES_HUGETLB_1GB;
+        page_size = HUGE_1GB;
+    }
+    if (!p && bytes >= HUGE_2MB) {
+        size = round_up(bytes, HUGE_2MB);
+        p = try_map(size, MAP_HUGETLB | (21 << MAP_HUGE_SHIFT));
+        kind = PAGES_HUGETLB_2MB;
+        page_size = HUGE_2MB;
+    }
+#endif
+
+    if (!p) {
+        size = round_up(bytes, page);
+        kind = PAGES_NORMAL;
+        page_size = page;
+#ifdef MADV_HUGEPAGE
+        // Transparent huge pages: nessuna riserva necessaria, il kernel usa pagine da 2 MB quando puo'.
+        // Il vettore parte da un indirizzo allineato a 2 MB, cosi' le porzioni dei worker coincidono con le huge pages
+        if (bytes >= HUGE_2MB) {
+            size = round_up(bytes, HUGE_2MB);
+            unsigned char *raw = try_map(size + HUGE_2MB, 0);
+            if (raw) {
+                unsigned char *aligned = (unsigned char *)round_up((size_t)raw, HUGE_2MB);
+                if (aligned > raw) munmap(raw, aligned - raw);
+                munmap(aligned + size, raw + HUGE_2MB - aligned);
+                p = aligned;
+                if (madvise(p, size, MADV_HUGEPAGE) == 0) {
+                    kind = PAGES_THP;
+                    page_size = HUGE_2MB;
+                }
+            }
+        }
+#endif
+        if (!p) {
+            size = round_up(bytes, page);
+            p = try_map(size, 0);
+            if (!p) return NULL;
+        }
+    }
+
+    allocs[slot].ptr = p;
+    allocs[slot].size = size;
+    allocs[slot].page = page_size;
+    allocs[slot].kind = kind;
+
+    touch_ctx ctx = {p, dim, page_size / sizeof(complex)};
+    pool_static(touch_task, &ctx);
+    return p;
+}
+
+void statevec_free(complex *vec) {
+    if (!vec) return;
+    for (int i = 0; i < MAX_STATEVECS; i++) {
+        if (allocs[i].ptr == vec) {
+            munmap(allocs[i].ptr, allocs[i].size);
+            allocs[i].ptr = NULL;
+            return;
+        }
+    }
+}
+
+size_t statevec_align(const complex *vec, size_t dim) {
+    for (int i = 0; i < MAX_STATEVECS; i++) {
+        if (allocs[i].ptr != vec) continue;
+        // Pagine intere solo se ogni worker ne riceve almeno una, altrimenti alcuni worker resterebbero senza lavoro
+        size_t align = allocs[i].page / sizeof(complex);
+        return dim >= align * pool_size() ? align : PARTITION_ALIGN;
+    }
+    return PARTITION_ALIGN;
+}
+
+// Byte coperti da transparent huge pages nella mappatura che contiene ptr
+// (campo AnonHugePages di /proc/self/smaps, 0 se non disponibile)
+static size_t thp_bytes(const void *ptr) {
+    FILE *fp = fopen("/proc/self/smaps", "r");
+    if (!fp) return 0;
+
+    char line[512];
+    int inside = 0;
+    size_t kb = 0;
+    unsigned long addr = (unsigned long)ptr;
+    while (fgets(line, sizeof(line), fp)) {
+        unsigned long start, end;
+        // Le righe di intestazione di ogni mappatura iniziano con "inizio-fine"
+        if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            inside = addr >= start && addr < end;
+        }
+        else if (inside && sscanf(line, "AnonHugePages: %zu kB", &kb) == 1) {
+            break;
+        }
+    }
+    fclose(fp);
+    return kb * 1024;
+}
+
+void statevec_report(const complex *vec, size_t dim, FILE *out) {
+    int slot = 0;
+    while (slot < MAX_STATEVECS && allocs[slot].ptr != vec) slot++;
+    if (slot == MAX_STATEVECS) return;
+
+    fprintf(out, "Vettore di stato: %zu byte, ", dim * sizeof(complex));
+    switch (allocs[slot].kind) {
+        case PAGES_HUGETLB_1GB:
+            fprintf(out, "hugetlb 1 GB");
+            break;
+        case PAGES_HUGETLB_2MB:
+            fprintf(out, "hugetlb 2 MB");
+            break;
+        case PAGES_THP: {
+            // madvise() riuscita non garantisce le huge pages: conta solo quelle ottenute dopo il first touch
+            size_t huge = thp_bytes(vec);
+            if (huge > 0) fprintf(out, "transparent huge pages (%zu byte su %zu)", huge, allocs[slot].size);
+            else fprintf(out, "pagine normali (THP richieste)");
+            break;
+        }
+        default:
+            fprintf(out, "pagine normali");
+            break;
+    }
+    fprintf(out, ", %d worker\n", pool_size());
+
+#ifdef SYS_move_pages
+    // move_pages con nodes == NULL non sposta nulla: restituisce il nodo su cui si trova ogni pagina
+    size_t page = sysconf(_SC_PAGESIZE);
+    for (int w = 0; w < pool_size(); w++) {
+        size_t begin, end;
+        pool_range(dim, w, statevec_align(vec, dim), &begin, &end);
+        if (begin >= end) continue;
+
+        // Campiona al piu' 64 pagine per worker
+        enum { SAMPLES = 64 };
+        void *pages[SAMPLES];
+        int status[SAMPLES];
+        size_t first = (size_t)(vec + begin) / page, last = ((size_t)(vec + end) - 1) / page;
+        size_t n_pages = last - first + 1;
+        int n = n_pages < SAMPLES ? (int)n_pages : SAMPLES;
+        for (int i = 0; i < n; i++) pages[i] = (void *)((first + i * n_pages / n) * page);
+
+        if (syscall(SYS_move_pages, 0, (unsigned long)n, pages, NULL, status, 0) != 0) {
+            fprintf(out, "  nodi NUMA non disponibili\n");
+            return;
+        }
+
+        int counts[64] = {0};
+        int other = 0;
+        for (int i = 0; i < n; i++) {
+            if (status[i] >= 0 && status[i] < 64) counts[status[i]]++;
+            else other++;
+        }
+        fprintf(out, "  worker %d [%zu, %zu):", w, begin, end);
+        for (int node = 0; node < 64; node++) {
+            if (counts[node]) fprintf(out, " nodo %d %d/%d", node, counts[node], n);
+        }
+        if (other) fprintf(out, " non residenti %d/%d", other, n);
+        fprintf(out, "\n");
+    }
+#else
+    fprintf(out, "  nodi NUMA non disponibili\n");
+#endif
+}
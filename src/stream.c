@@ -0,0 +1,129 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include "gate.h"
+#include "loader.h"
+#include "pool.h"
+#include "stream.h"
+#include "utils.h"
+
+// Limiti della coda tra il thread di caricamento e quello che applica i gate:
+// il caricamento si ferma quando la coda e' piena o le matrici in coda superano STREAM_QUEUE_BYTES
+#define STREAM_QUEUE_GATES 256
+#define STREAM_QUEUE_BYTES (256UL << 20)
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    gate slots[STREAM_QUEUE_GATES];     // Coda circolare
+    int head;
+    int count;
+    size_t bytes;       // Memoria delle matrici in coda
+    size_t peak_bytes;
+    int closed;         // Il caricamento e' terminato
+    int failed;         // Il caricamento e' fallito
+
+    const char *filename;
+    int n_qubits;
+    size_t dim;
+} stream_queue;
+
+// Memoria delle matrici proprie di un gate (compresi i gate di un blocco): una matrice condivisa
+// con le altre occorrenze dello stesso #define non occupa memoria in piu'
+static size_t gate_bytes(const gate *g, size_t dim) {
+    size_t bytes = g->matrix && !g->storage ? dim * dim * sizeof(complex) : 0;
+    for (int i = 0; i < g->n_sub; i++) bytes += gate_bytes(&g->sub[i], dim);
+    return bytes;
+}
+
+// Sink del caricamento: attende spazio nella coda e ci sposta il gate
+static int queue_push(gate *g, void *arg) {
+    stream_queue *q = arg;
+    size_t bytes = gate_bytes(g, q->dim);
+
+    pthread_mutex_lock(&q->lock);
+    // Un gate piu' grande del limite passa comunque, ma da solo
+    while (q->count == STREAM_QUEUE_GATES || (q->count > 0 && q->bytes + bytes > STREAM_QUEUE_BYTES))
+        pthread_cond_wait(&q->not_full, &q->lock);
+    q->slots[(q->head + q->count) % STREAM_QUEUE_GATES] = *g;
+    q->count++;
+    q->bytes += bytes;
+    if (q->bytes > q->peak_bytes) q->peak_bytes = q->bytes;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return EXIT_SUCCESS;
+}
+
+static void *producer(void *arg) {
+    stream_queue *q = arg;
+    pool_unpin();
+    int ret = load_gates_stream(q->filename, q->n_qubits, queue_push, q);
+
+    pthread_mutex_lock(&q->lock);
+    q->closed = 1;
+    q->failed = ret != EXIT_SUCCESS;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return NULL;
+}
+
+int run_stream(const char *filename, int n_qubits, complex *vec, complex *t_vec, stream_stats *stats) {
+    double start_ms = now_ms();
+    stream_queue *q = calloc(1, sizeof(stream_queue));
+    if (!q) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    q->filename = filename;
+    q->n_qubits = n_qubits;
+    q->dim = 1UL << n_qubits;
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, producer, q) != 0) {
+        perror("Creazione thread fallita");
+        free(q);
+        return EXIT_FAILURE;
+    }
+
+    // Consumatore: applica i gate nell'ordine di arrivo e li libera subito
+    stream_stats st = {0, 0.0, 0};
+    while (1) {
+        pthread_mutex_lock(&q->lock);
+        while (q->count == 0 && !q->closed) pthread_cond_wait(&q->not_empty, &q->lock);
+        if (q->failed || q->count == 0) {
+            pthread_mutex_unlock(&q->lock);
+            break;
+        }
+        gate g = q->slots[q->head];
+        q->head = (q->head + 1) % STREAM_QUEUE_GATES;
+        q->count--;
+        q->bytes -= gate_bytes(&g, q->dim);
+        pthread_cond_signal(&q->not_full);
+        pthread_mutex_unlock(&q->lock);
+
+        apply_gate(&g, vec, t_vec, q->dim);
+        gate_release(&g);
+        if (st.n_gates++ == 0) st.first_gate_ms = now_ms() - start_ms;
+    }
+
+    pthread_join(thread, NULL);
+
+    // In caso di errore nel file restano in coda i gate non applicati
+    for (int i = 0; i < q->count; i++) {
+        gate_release(&q->slots[(q->head + i) % STREAM_QUEUE_GATES]);
+    }
+    int ret = q->failed ? EXIT_FAILURE : EXIT_SUCCESS;
+    st.peak_bytes = q->peak_bytes;
+    if (stats) *stats = st;
+
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_mutex_destroy(&q->lock);
+    free(q);
+    return ret;
+}
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sweep.h"
+#include "pool.h"
+#include "utils.h"
+
+// Memoria privata di un worker: copia del circuito (i gate parametrici hanno la propria matrice 2x2)
+typedef struct {
+    gate *gates;
+    complex *t_vec;
+} sweep_scratch;
+
+typedef struct {
+    const gate *circuit;
+    int n_gates;
+    const double *points;
+    int n_params;
+    const complex *init_vec;
+    int n_qubits;
+    size_t first;           // Primo punto del gruppo corrente
+    complex *results;       // Stati finali del gruppo corrente
+    sweep_scratch *scratch; // Uno per worker
+} sweep_ctx;
+
+// Libera una copia fatta da copy_gates() (solo gli array, non le matrici condivise)
+static void free_gates_copy(gate *gates, int n_gates) {
+    if (!gates) return;
+    for (int i = 0; i < n_gates; i++) {
+        if (gates[i].kind == GATE_BLOCK) free_gates_copy(gates[i].sub, gates[i].n_sub);
+    }
+    free(gates);
+}
+
+// Copia superficiale di una lista di gate: le matrici dei gate GATE_MATRIX sono condivise con l'originale,
+// i gate dei blocchi vengono copiati perche' anche loro possono essere parametrici
+static gate *copy_gates(const gate *circuit, int n_gates) {
+    gate *gates = malloc(n_gates * sizeof(gate));
+    if (!gates) return NULL;
+    memcpy(gates, circuit, n_gates * sizeof(gate));
+    for (int i = 0; i < n_gates; i++) {
+        if (gates[i].kind != GATE_BLOCK) continue;
+        gates[i].sub = copy_gates(circuit[i].sub, circuit[i].n_sub);
+        if (!gates[i].sub) {
+            // I blocchi successivi puntano ancora all'originale: non vanno liberati
+            for (int j = i + 1; j < n_gates; j++) gates[j].sub = NULL;
+            free_gates_copy(gates, n_gates);
+            return NULL;
+        }
+    }
+    return gates;
+}
+
+static int init_scratch(sweep_scratch *s, const gate *circuit, int n_gates, size_t dim) {
+    s->gates = copy_gates(circuit, n_gates);
+    s->t_vec = malloc(dim * sizeof(complex));
+    if (!s->gates || !s->t_vec) {
+        free_gates_copy(s->gates, n_gates);
+        free(s->t_vec);
+        s->gates = NULL;
+        s->t_vec = NULL;
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+static int sweep_point(size_t idx, int worker, void *arg) {
+    sweep_ctx *ctx = arg;
+    sweep_scratch *s = &ctx->scratch[worker];
+    size_t dim = 1UL << ctx->n_qubits;
+
+    if (!s->gates && init_scratch(s, ctx->circuit, ctx->n_gates, dim)) {
+        perror("Allocazione memoria fallita");
+        return EXIT_FAILURE;
+    }
+
+    // Ricalcola solo i gate parametrici con i valori del punto
+    const double *values = ctx->points + (ctx->first + idx) * ctx->n_params;
+    for (int i = 0; i < ctx->n_gates; i++) {
+        gate_bind(&s->gates[i], values);
+    }
+
+    complex *vec = ctx->results + idx * dim;
+    memcpy(vec, ctx->init_vec, dim * sizeof(complex));
+    apply_circuit(s->gates, ctx->n_gates, vec, s->t_vec, dim);
+    return EXIT_SUCCESS;
+}
+
+int run_sweep(const gate *circuit, int n_gates, const double *points, int n_params, int n_points,
+              const complex *init_vec, int n_qubits) {
+    int n_workers = pool_size();
+    sweep_ctx ctx;
+    ctx.circuit = circuit;
+    ctx.n_gates = n_gates;
+    ctx.points = points;
+    ctx.n_params = n_params;
+    ctx.init_vec = init_vec;
+    ctx.n_qubits = n_qubits;
+
+    // I punti vengono eseguiti a gruppi di un punto per worker: in memoria restano solo gli stati del gruppo
+    // corrente, stampati nell'ordine del file prima di passare al gruppo successivo
+    size_t dim = 1UL << n_qubits;
+    size_t batch = (size_t)n_workers < (size_t)n_points ? (size_t)n_workers : (size_t)n_points;
+    ctx.results = malloc(batch * dim * sizeof(complex));
+    ctx.scratch = calloc(n_workers, sizeof(sweep_scratch));
+    if (!ctx.results || !ctx.scratch) {
+        perror("Allocazione memoria fallita");
+        free(ctx.results);
+        free(ctx.scratch);
+        return EXIT_FAILURE;
+    }
+
+    int ret = EXIT_SUCCESS;
+    for (ctx.first = 0; ctx.first < (size_t)n_points && ret == EXIT_SUCCESS; ctx.first += batch) {
+        size_t n = (size_t)n_points - ctx.first < batch ? (size_t)n_points - ctx.first : batch;
+        ret = pool_for(n, sweep_point, &ctx);
+        for (size_t i = 0; i < n && ret == EXIT_SUCCESS; i++) complex_vec_print(ctx.results + i * dim, dim);
+    }
+
+    free(ctx.results);
+    for (int i = 0; i < n_workers; i++) {
+        free_gates_copy(ctx.scratch[i].gates, n_gates);
+        free(ctx.scratch[i].t_vec);
+    }
+    free(ctx.scratch);
+    return ret;
+}
@@ -0,0 +1,184 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "parser.h"
+#include "pool.h"
+#include "unitary.h"
+#include "utils.h"
+
+// Formato binario (endianness nativa): unitary_header seguito da dim*dim complex, per righe
+#define UNITARY_MAGIC "QCSUNIT"
+#define UNITARY_VERSION 1
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_qubits;
+} unitary_header;
+
+typedef struct {
+    const gate *g;
+    complex *cols;      // Matrice per colonne: la colonna j e' contigua
+    size_t dim;
+    complex **scratch;  // Vettore temporaneo di ogni worker (per i GATE_MATRIX dentro ai blocchi)
+} column_ctx;
+
+// Applica il gate alla colonna j
+static int apply_column(size_t j, int worker, void *arg) {
+    column_ctx *ctx = arg;
+    if (!ctx->scratch[worker]) {
+        ctx->scratch[worker] = malloc(ctx->dim * sizeof(complex));
+        if (!ctx->scratch[worker]) {
+            perror("Allocazione memoria fallita");
+            return EXIT_FAILURE;
+        }
+    }
+    apply_gate(ctx->g, ctx->cols + j * ctx->dim, ctx->scratch[worker], ctx->dim);
+    return EXIT_SUCCESS;
+}
+
+// Trasposta in-place di una matrice quadrata
+static void transpose(complex *M, size_t dim) {
+    for (size_t i = 0; i < dim; i++) {
+        for (size_t j = i + 1; j < dim; j++) {
+            complex t = M[i * dim + j];
+            M[i * dim + j] = M[j * dim + i];
+            M[j * dim + i] = t;
+        }
+    }
+}
+
+int circuit_unitary(const gate *circuit, int n_gates, size_t dim, complex *out) {
+    int ret = EXIT_FAILURE;
+    size_t bytes = dim * dim * sizeof(complex);
+    int n_workers = pool_size();
+    complex *cols = out;            // U per colonne, cioe' U trasposta per righe
+    complex *prod = malloc(bytes);  // Risultato dei prodotti (si scambia con cols, uno dei due e' sempre "out")
+    complex *mt = malloc(bytes);    // Trasposta della matrice del gate
+    column_ctx ctx = {NULL, NULL, dim, calloc(n_workers, sizeof(complex *))};
+    if (!prod || !mt || !ctx.scratch) {
+        perror("Allocazione memoria fallita");
+        goto cleanup;
+    }
+
+    memset(cols, 0, bytes);
+    for (size_t i = 0; i < dim; i++) cols[i * dim + i].re = 1.0;
+
+    for (int i = 0; i < n_gates; i++) {
+        const gate *g = &circuit[i];
+        if (g->kind == GATE_MATRIX) {
+            // (M * U)^T = U^T * M^T
+            memcpy(mt, g->matrix, bytes);
+            transpose(mt, dim);
+            matmul(cols, mt, prod, dim);
+            complex *swap = cols; cols = prod; prod = swap;
+        }
+        else {
+            ctx.g = g;
+            ctx.cols = cols;
+            if (pool_for(dim, apply_column, &ctx)) goto cleanup;
+        }
+    }
+
+    transpose(cols, dim);
+    if (cols != out) memcpy(out, cols, bytes);
+    ret = EXIT_SUCCESS;
+
+cleanup:
+    free(cols == out ? prod : cols);
+    free(mt);
+    if (ctx.scratch) {
+        for (int i = 0; i < n_workers; i++) free(ctx.scratch[i]);
+        free(ctx.scratch);
+    }
+    return ret;
+}
+
+// Stampa un complesso nel formato accettato da parse_complex() (a+ib), senza perdita di precisione.
+// Il segno della parte immaginaria viene da signbit(), cosi' -0 diventa "-i0" e non "+i-0";
+// il testo viene riletto con parse_complex() per garantire che il file si possa importare
+static int write_complex(FILE *fp, const char *path, complex c) {
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%.17g%ci%.17g", c.re, signbit(c.im) ? '-' : '+', fabs(c.im));
+
+    complex back;
+    if (parse_complex(buf, &back) || back.re != c.re || back.im != c.im) {
+        fprintf(stderr, "Errore in %s: valore non rileggibile (%s)\n", path, buf);
+        return EXIT_FAILURE;
+    }
+    fputs(buf, fp);
+    return EXIT_SUCCESS;
+}
+
+int unitary_write(const char *path, const complex *U, int n_qubits) {
+    size_t dim = 1UL << n_qubits;
+    size_t len = strlen(path);
+    int binary = len >= 4 && strcmp(path + len - 4, ".bin") == 0;
+
+    FILE *fp = fopen(path, binary ? "wb" : "w");
+    if (!fp) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+
+    if (binary) {
+        unitary_header hdr;
+        memset(&hdr, 0, sizeof(hdr));
+        memcpy(hdr.magic, UNITARY_MAGIC, 8);
+        hdr.version = UNITARY_VERSION;
+        hdr.n_qubits = n_qubits;
+        fwrite(&hdr, sizeof(hdr), 1, fp);
+        fwrite(U, sizeof(complex), dim * dim, fp);
+    }
+    else {
+        // Una riga della matrice per riga di testo
+        fprintf(fp, "#define U [\n");
+        for (size_t i = 0; i < dim; i++) {
+            fputc('(', fp);
+            for (size_t j = 0; j < dim; j++) {
+                if (j) fputs(", ", fp);
+                if (write_complex(fp, path, U[i * dim + j])) {
+                    fclose(fp);
+                    return EXIT_FAILURE;
+                }
+            }
+            fputs(i + 1 < dim ? "),\n" : ")\n", fp);
+        }
+        fprintf(fp, "]\n");
+    }
+
+    int err = ferror(fp);
+    if (fclose(fp) != 0 || err) {
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+int unitary_is_bin(const void *buf, size_t len) {
+    return len >= sizeof(unitary_header) && memcmp(buf, UNITARY_MAGIC, 8) == 0;
+}
+
+int unitary_read_bin(const char *path, const void *buf, size_t len, int n_qubits, complex *out) {
+    size_t dim = 1UL << n_qubits;
+    size_t bytes = dim * dim * sizeof(complex);
+    unitary_header hdr;
+    memcpy(&hdr, buf, sizeof(hdr));
+
+    if (hdr.version != UNITARY_VERSION) {
+        fprintf(stderr, "Errore in %s: Versione del formato non supportata (%u)\n", path, hdr.version);
+        return EXIT_FAILURE;
+    }
+    if (hdr.n_qubits != (uint32_t)n_qubits) {
+        fprintf(stderr, "Errore in %s: Numero qubits diverso (%u invece di %d)\n", path, hdr.n_qubits, n_qubits);
+        return EXIT_FAILURE;
+    }
+    if (len != sizeof(hdr) + bytes) {
+        fprintf(stderr, "Errore in %s: Dimensione del file errata\n", path);
+        return EXIT_FAILURE;
+    }
+    memcpy(out, (const unsigned char *)buf + sizeof(hdr), bytes);
+    return EXIT_SUCCESS;
+}
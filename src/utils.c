@@ -2,6 +2,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <time.h>
+#include "pool.h"
 #include "utils.h"
 
 void trim_whitespace(char *str) {
@@ -36,67 +38,66 @@ void trim_whitespace(char *str) {
     *(end + 1) = '\0'; // Nuova fine stringa.
 }
 
-char *string_append(char *dest, const char *src) {
-    if (!src) return dest;
-    if (!dest) { // Creo destinazione in caso fosse NULL in input
-        dest = malloc(strlen(src) + 1);
-        if (dest) strcpy(dest, src);
-        return dest;
-    }
-    size_t old_len = strlen(dest);
-    size_t src_len = strlen(src);
-    char *new_dest = realloc(dest, old_len + src_len + 1); // Crea spazio per ospitare la nuova stringa
-    if (!new_dest) {
-        free(dest);
-        return NULL;
-    }
-    strcpy(new_dest + old_len, src); // Aggiungo la seconda parte della stringa
-    return new_dest;
+double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
 }
 
-char *read_line(FILE *fp) {
-    if (!fp) return NULL;
-    char *buffer = NULL;
-    size_t buffer_size = 0;
-    size_t length = 0;
-    
-    while (1) { // Prosegue fino a EOF, newline, o errore
-        int c = fgetc(fp);
-        if (c == EOF) {
-            if (length == 0) return NULL;
-            break;
-        }
-        
-        // Aggiorna la dimensione del buffer
-        if (length + 2 >= buffer_size) { // Spazio per il prossimo carattere e anche per il null terminator
-            size_t new_size = buffer_size ? buffer_size * 2 : 128; // Raddoppia dimensione ogni volta (Ottima prassi per evitare chiamate frequenti)
-            char *new_buffer = realloc(buffer, new_size);
-            if (!new_buffer) {
-                free(buffer);
-                return NULL;
-            }
-            buffer = new_buffer;
-            buffer_size = new_size;
+void matvec_mul_rows(const complex *M, const complex *in_vec, complex *out_vec, size_t dim, size_t row_begin, size_t row_end) {
+    for (size_t i = row_begin; i < row_end; i++) {
+        complex sum = {0.0, 0.0};
+        for (size_t j = 0; j < dim; j++) {
+            complex prod = complex_mul(M[i * dim + j], in_vec[j]);
+            sum = complex_add(sum, prod);
         }
-        
-        buffer[length++] = c;
-        if (c == '\n') break;
+        out_vec[i] = sum;
     }
-
-    buffer[length] = '\0'; // Null terminator sicuro
-    return buffer;
 }
 
+// Lato dei blocchi del prodotto di matrici: tre blocchi 64x64 di complex (192 KB) restano in cache L2
+#define MATMUL_BLOCK 64
 
-void matvec_mul(const complex *M, const complex *in_vec, complex *out_vec, int dim) {
-    for (int i = 0; i < dim; i++) {
-        complex sum = {0.0, 0.0};
-        for (int j = 0; j < dim; j++) {
-            complex prod = complex_mul(M[i * dim + j], in_vec[j]);
-            sum = complex_add(sum, prod);
+typedef struct {
+    const complex *A;
+    const complex *B;
+    complex *C;
+    size_t dim;
+} matmul_ctx;
+
+// Calcola un blocco di MATMUL_BLOCK righe di C, scorrendo A e B a blocchi
+static int matmul_rows(size_t task, int worker, void *arg) {
+    (void)worker;
+    matmul_ctx *ctx = arg;
+    size_t dim = ctx->dim;
+    size_t i0 = task * MATMUL_BLOCK;
+    size_t i1 = i0 + MATMUL_BLOCK < dim ? i0 + MATMUL_BLOCK : dim;
+
+    memset(ctx->C + i0 * dim, 0, (i1 - i0) * dim * sizeof(complex));
+    for (size_t k0 = 0; k0 < dim; k0 += MATMUL_BLOCK) {
+        size_t k1 = k0 + MATMUL_BLOCK < dim ? k0 + MATMUL_BLOCK : dim;
+        for (size_t j0 = 0; j0 < dim; j0 += MATMUL_BLOCK) {
+            size_t j1 = j0 + MATMUL_BLOCK < dim ? j0 + MATMUL_BLOCK : dim;
+            // Ordine i-k-j dentro al blocco: le righe di B e C vengono lette in sequenza
+            for (size_t i = i0; i < i1; i++) {
+                complex *c = ctx->C + i * dim;
+                for (size_t k = k0; k < k1; k++) {
+                    complex a = ctx->A[i * dim + k];
+                    const complex *b = ctx->B + k * dim;
+                    for (size_t j = j0; j < j1; j++) {
+                        c[j].re += a.re * b[j].re - a.im * b[j].im;
+                        c[j].im += a.re * b[j].im + a.im * b[j].re;
+                    }
+                }
+            }
         }
-        out_vec[i] = sum;
     }
+    return EXIT_SUCCESS;
+}
+
+void matmul(const complex *A, const complex *B, complex *C, size_t dim) {
+    matmul_ctx ctx = {A, B, C, dim};
+    pool_for((dim + MATMUL_BLOCK - 1) / MATMUL_BLOCK, matmul_rows, &ctx);
 }
 
 float float_abs(float val) {